@@ -7,6 +7,7 @@
 #include "context.hh"
 #include "diff.hh"
 #include "file.hh"
+#include "file_watcher.hh"
 #include "flags.hh"
 #include "option_types.hh"
 #include "ranges.hh"
@@ -111,6 +112,9 @@ void Buffer::on_registered()
 
     if (m_flags & Flags::File)
     {
+        if (FileWatcher::has_instance())
+            FileWatcher::instance().watch(*this);
+
         if (m_flags & Buffer::Flags::New)
             run_hook_in_own_context("BufNewFile", m_name);
         else
@@ -129,6 +133,9 @@ void Buffer::on_unregistered()
     if (m_flags & Flags::Debug)
         return;
 
+    if (FileWatcher::has_instance())
+        FileWatcher::instance().unwatch(*this);
+
     options().unregister_watcher(*this);
     run_hook_in_own_context("BufClose", m_name);
 }
@@ -140,19 +147,24 @@ Buffer::~Buffer()
 
 bool Buffer::set_name(String name)
 {
-    Buffer* other = BufferManager::instance().get_buffer_ifp(name);
+    auto& buffer_manager = BufferManager::instance();
+    Buffer* other = buffer_manager.get_buffer_ifp(name);
     if (other == nullptr or other == this)
     {
+        const String old_name = m_name, old_display_name = m_display_name;
         if (m_flags & Flags::File)
         {
             m_name = real_path(name);
             m_display_name = compact_path(m_name);
+            if (FileWatcher::has_instance())
+                FileWatcher::instance().watch(*this);
         }
         else
         {
             m_name = std::move(name);
             m_display_name = m_name;
         }
+        buffer_manager.update_buffer_names(*this, old_name, old_display_name);
         return true;
     }
     return false;
@@ -160,8 +172,12 @@ bool Buffer::set_name(String name)
 
 void Buffer::update_display_name()
 {
-    if (m_flags & Flags::File)
-        m_display_name = compact_path(m_name);
+    if (not (m_flags & Flags::File))
+        return;
+
+    String old_display_name = std::exchange(m_display_name, compact_path(m_name));
+    if (BufferManager::has_instance())
+        BufferManager::instance().update_buffer_names(*this, m_name, old_display_name);
 }
 
 BufferIterator Buffer::iterator_at(BufferCoord coord) const
@@ -250,42 +266,47 @@ void Buffer::reload(StringView data, timespec fs_timestamp)
     }
     else
     {
-        auto diff = find_diff(m_lines.begin(), m_lines.size(),
-                              parsed_lines.lines.begin(), parsed_lines.lines.size(),
-                              [](const StringDataPtr& lhs, const StringDataPtr& rhs)
-                              { return lhs->strview() == rhs->strview(); });
-
+        auto diff = find_hashed_diff(m_lines.begin(), m_lines.size(),
+                                     parsed_lines.lines.begin(), parsed_lines.lines.size(),
+                                     [](const StringDataPtr& line) { return line->hash; },
+                                     [](const StringDataPtr& lhs, const StringDataPtr& rhs)
+                                     { return lhs->hash == rhs->hash and lhs->strview() == rhs->strview(); });
+
+        // build the new line list in one pass, inserting and erasing
+        // in place would move the following lines for each change
+        BufferLines new_lines;
+        new_lines.reserve(parsed_lines.lines.size());
         auto it = m_lines.begin();
         for (auto& d : diff)
         {
+            const LineCount cur_line = (int)new_lines.size();
             if (d.mode == Diff::Keep)
+            {
+                std::move(it, it + d.len, std::back_inserter(new_lines));
                 it += d.len;
+            }
             else if (d.mode == Diff::Add)
             {
-                const LineCount cur_line = (int)(it - m_lines.begin());
-
                 for (LineCount line = 0; line < d.len; ++line)
                     m_current_undo_group.push_back({
                         Modification::Insert, cur_line + line,
                         parsed_lines.lines[(int)(d.posB + line)]});
 
                 m_changes.push_back({ Change::Insert, cur_line, cur_line + d.len });
-                m_lines.insert(it, &parsed_lines.lines[d.posB], &parsed_lines.lines[d.posB + d.len]);
-                it = m_lines.begin() + (int)(cur_line + d.len);
+                std::move(&parsed_lines.lines[d.posB], &parsed_lines.lines[d.posB + d.len],
+                          std::back_inserter(new_lines));
             }
             else if (d.mode == Diff::Remove)
             {
-                const LineCount cur_line = (int)(it - m_lines.begin());
-
                 for (LineCount line = d.len-1; line >= 0; --line)
                     m_current_undo_group.push_back({
-                        Modification::Erase, cur_line + line,
-                        m_lines.get_storage(cur_line + line)});
+                        Modification::Erase, cur_line + line, *(it + (int)line)});
 
-                it = m_lines.erase(it, it + d.len);
+                it += d.len;
                 m_changes.push_back({ Change::Erase, cur_line, cur_line + d.len });
             }
         }
+        static_cast<BufferLines&>(m_lines) = std::move(new_lines);
     }
 
     commit_undo_group();
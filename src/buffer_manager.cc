@@ -16,6 +16,8 @@ BufferManager::~BufferManager()
     // Move buffers to m_buffer_trash to avoid running BufClose
     // hook while clearing m_buffers
     m_buffer_trash = std::move(m_buffers);
+    m_buffers_by_name.clear();
+    m_buffers_by_display_name.clear();
 
     for (auto& buffer : m_buffer_trash)
         buffer->on_unregistered();
@@ -27,17 +29,13 @@ BufferManager::~BufferManager()
 Buffer* BufferManager::create_buffer(String name, Buffer::Flags flags,
                                      StringView data, timespec fs_timestamp)
 {
-    auto path = real_path(parse_filename(name));
-    for (auto& buf : m_buffers)
-    {
-        if (buf->name() == name or
-            (buf->flags() & Buffer::Flags::File and buf->name() == path))
-            throw runtime_error{"buffer name is already in use"};
-    }
+    if (get_buffer_ifp(name))
+        throw runtime_error{"buffer name is already in use"};
 
     m_buffers.emplace(m_buffers.begin(),
                       new Buffer{std::move(name), flags, data, fs_timestamp});
     auto& buffer = *m_buffers.front();
+    add_buffer_names(buffer);
     buffer.on_registered();
 
     if (contains(m_buffer_trash, &buffer))
@@ -54,6 +52,7 @@ void BufferManager::delete_buffer(Buffer& buffer)
 
     m_buffer_trash.emplace_back(std::move(*it));
     m_buffers.erase(it);
+    remove_buffer_names(buffer, buffer.name(), buffer.display_name());
 
     ClientManager::instance().ensure_no_client_uses_buffer(buffer);
 
@@ -62,13 +61,17 @@ void BufferManager::delete_buffer(Buffer& buffer)
 
 Buffer* BufferManager::get_buffer_ifp(StringView name)
 {
-    auto path = real_path(parse_filename(name));
-    for (auto& buf : m_buffers)
-    {
-        if (buf->name() == name or
-            (buf->flags() & Buffer::Flags::File and buf->name() == path))
-            return buf.get();
-    }
+    auto it = m_buffers_by_name.find(name);
+    if (it != m_buffers_by_name.end())
+        return it->value;
+
+    it = m_buffers_by_display_name.find(name);
+    if (it != m_buffers_by_display_name.end())
+        return it->value;
+
+    it = m_buffers_by_name.find(real_path(parse_filename(name)));
+    if (it != m_buffers_by_name.end() and it->value->flags() & Buffer::Flags::File)
+        return it->value;
     return nullptr;
 }
 
@@ -89,6 +92,36 @@ Buffer& BufferManager::get_first_buffer()
     return *m_buffers.front();
 }
 
+void BufferManager::add_buffer_names(Buffer& buffer)
+{
+    kak_assert(not m_buffers_by_name.contains(buffer.name()));
+    m_buffers_by_name.insert({buffer.name(), &buffer});
+    if ((buffer.flags() & Buffer::Flags::File) and
+        not m_buffers_by_display_name.contains(buffer.display_name()))
+        m_buffers_by_display_name.insert({buffer.display_name(), &buffer});
+}
+
+void BufferManager::remove_buffer_names(Buffer& buffer, StringView name, StringView display_name)
+{
+    auto it = m_buffers_by_name.find(name);
+    if (it != m_buffers_by_name.end() and it->value == &buffer)
+        m_buffers_by_name.unordered_remove(name);
+
+    it = m_buffers_by_display_name.find(display_name);
+    if (it != m_buffers_by_display_name.end() and it->value == &buffer)
+        m_buffers_by_display_name.unordered_remove(display_name);
+}
+
+void BufferManager::update_buffer_names(Buffer& buffer, StringView old_name, StringView old_display_name)
+{
+    auto it = m_buffers_by_name.find(old_name);
+    if (it == m_buffers_by_name.end() or it->value != &buffer)
+        return; // not registered
+
+    remove_buffer_names(buffer, old_name, old_display_name);
+    add_buffer_names(buffer);
+}
+
 void BufferManager::backup_modified_buffers()
 {
     for (auto& buf : m_buffers)
@@ -2,6 +2,7 @@
 #define buffer_manager_hh_INCLUDED
 
 #include "buffer.hh"
+#include "hash_map.hh"
 #include "vector.hh"
 
 #include <memory>
@@ -32,12 +33,24 @@ public:
 
     Buffer& get_first_buffer();
 
+    // Must be called when the name or display name of a registered buffer changed
+    void update_buffer_names(Buffer& buffer, StringView old_name, StringView old_display_name);
+
     void backup_modified_buffers();
 
     void clear_buffer_trash();
 private:
+    void add_buffer_names(Buffer& buffer);
+    void remove_buffer_names(Buffer& buffer, StringView name, StringView display_name);
+
     BufferList m_buffers;
     BufferList m_buffer_trash;
+
+    // Buffer names are unique, and file buffer names are real paths.
+    // Display names only avoid resolving the path of file buffers, a
+    // display name shared by several buffers is only indexed once.
+    HashMap<String, Buffer*, MemoryDomain::BufferMeta> m_buffers_by_name;
+    HashMap<String, Buffer*, MemoryDomain::BufferMeta> m_buffers_by_display_name;
 };
 
 }
@@ -5,6 +5,7 @@
 #include "buffer_manager.hh"
 #include "buffer_utils.hh"
 #include "file.hh"
+#include "file_watcher.hh"
 #include "remote.hh"
 #include "option.hh"
 #include "client_manager.hh"
@@ -50,6 +51,13 @@ Client::Client(std::unique_ptr<UserInterface>&& ui,
         else
             m_pending_keys.push_back(key);
     });
+    m_ui->set_on_menu_fetch([this](int first, int count) {
+        const int item_count = m_menu.items.size();
+        first = clamp(first, 0, item_count);
+        count = std::min(count, item_count - first);
+        if (count > 0)
+            m_ui->menu_items(first, {m_menu.items.data() + first, (size_t)count});
+    });
 
     m_window->hooks().run_hook("WinDisplay", m_window->buffer().name(), context());
 
@@ -68,7 +76,7 @@ Client::~Client()
 
 bool Client::process_pending_inputs()
 {
-    const bool debug_keys = (bool)(context().options()["debug"].get<DebugFlags>() & DebugFlags::Keys);
+    const bool debug_keys = (bool)(context().options().get(debug_option) & DebugFlags::Keys);
     // steal keys as we might receive new keys while handling them.
     Vector<Key, MemoryDomain::Client> keys = std::move(m_pending_keys);
     for (auto& key : keys)
@@ -108,7 +116,7 @@ void Client::print_status(DisplayLine status_line, bool immediate)
     m_status_line = std::move(status_line);
     if (immediate)
     {
-        m_ui->draw_status(m_status_line, m_mode_line, get_face("StatusLine"));
+        m_ui->draw_status(m_status_line, m_mode_line, status_line_face.get());
         m_ui->refresh(true);
     }
     else
@@ -148,7 +156,7 @@ DisplayLine Client::generate_mode_line() const
     {
         const String& modelinefmt = context().options()["modelinefmt"].get<String>();
         HashMap<String, DisplayLine> atoms{{ "mode_info", context().client().input_handler().mode_line() },
-                                           { "context_info", {generate_context_info(context()), get_face("Information")}}};
+                                           { "context_info", {generate_context_info(context()), information_face.get()}}};
         auto expanded = expand(modelinefmt, context(), ShellContext{},
                                [](String s) { return escape(s, '{', '\\'); });
         modeline = parse_display_line(expanded, atoms);
@@ -215,7 +223,7 @@ void Client::redraw_ifn()
 
     if (m_ui_pending & Draw)
         m_ui->draw(window.update_display_buffer(context()),
-                   get_face("Default"), get_face("BufferPadding"));
+                   default_face.get(), buffer_padding_face.get());
 
     const bool update_menu_anchor = (m_ui_pending & Draw) and not (m_ui_pending & MenuHide) and
                                     not m_menu.items.empty() and m_menu.style == MenuStyle::Inline;
@@ -228,9 +236,12 @@ void Client::redraw_ifn()
         m_menu.ui_anchor = anchor;
     }
 
+    // The ui fetches the items following the first page when it displays them
+    constexpr size_t menu_page_size = 128;
     if (m_ui_pending & MenuShow and m_menu.ui_anchor)
-        m_ui->menu_show(m_menu.items, *m_menu.ui_anchor,
-                        get_face("MenuForeground"), get_face("MenuBackground"),
+        m_ui->menu_show({m_menu.items.data(), std::min(m_menu.items.size(), menu_page_size)},
+                        (int)m_menu.items.size(), m_menu.longest, *m_menu.ui_anchor,
+                        menu_foreground_face.get(), menu_background_face.get(),
                         m_menu.style);
     if (m_ui_pending & MenuSelect and m_menu.ui_anchor)
         m_ui->menu_select(m_menu.selected);
@@ -250,17 +261,17 @@ void Client::redraw_ifn()
 
     if (m_ui_pending & InfoShow and m_info.ui_anchor)
         m_ui->info_show(m_info.title, m_info.content, *m_info.ui_anchor,
-                        get_face("Information"), m_info.style);
+                        information_face.get(), m_info.style);
     if (m_ui_pending & InfoHide)
         m_ui->info_hide();
 
     if (m_ui_pending & StatusLine)
-        m_ui->draw_status(m_status_line, m_mode_line, get_face("StatusLine"));
+        m_ui->draw_status(m_status_line, m_mode_line, status_line_face.get());
 
     auto cursor = m_input_handler.get_cursor_info();
     m_ui->set_cursor(cursor.first, cursor.second);
 
-    m_ui->refresh(m_ui_pending | Refresh);
+    m_ui->refresh(m_ui_pending & Refresh);
     m_ui_pending = 0;
 }
 
@@ -326,10 +337,20 @@ void Client::check_if_buffer_needs_reloading()
     if (not (buffer.flags() & Buffer::Flags::File) or reload == Autoreload::No)
         return;
 
+    // watched files only need to be checked once modified
+    if (FileWatcher::has_instance() and not FileWatcher::instance().check_modified(buffer))
+        return;
+
     const String& filename = buffer.name();
     timespec ts = get_fs_timestamp(filename);
-    if (ts == InvalidTime or ts == buffer.fs_timestamp())
+    if (ts == InvalidTime)
         return;
+    if (ts == buffer.fs_timestamp())
+    {
+        if (FileWatcher::has_instance())
+            FileWatcher::instance().clear_modified(buffer);
+        return;
+    }
     if (reload == Autoreload::Ask)
     {
         StringView bufname = buffer.display_name();
@@ -364,7 +385,10 @@ void Client::on_option_changed(const Option& option)
 
 void Client::menu_show(Vector<DisplayLine> choices, BufferCoord anchor, MenuStyle style)
 {
-    m_menu = Menu{ std::move(choices), anchor, {}, style, -1 };
+    ColumnCount longest = 1;
+    for (auto& choice : choices)
+        longest = std::max(longest, choice.length());
+    m_menu = Menu{ std::move(choices), longest, anchor, {}, style, -1 };
     m_ui_pending |= MenuShow;
     m_ui_pending &= ~MenuHide;
 }
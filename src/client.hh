@@ -112,6 +112,7 @@ private:
     struct Menu
     {
         Vector<DisplayLine> items;
+        ColumnCount longest;
         BufferCoord anchor;
         Optional<DisplayCoord> ui_anchor;
         MenuStyle style;
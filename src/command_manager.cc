@@ -444,7 +444,7 @@ void CommandManager::execute_single_command(CommandParameters params,
     if (command_it == m_commands.end())
         throw command_not_found(params[0]);
 
-    const DebugFlags debug_flags = context.options()["debug"].get<DebugFlags>();
+    const DebugFlags debug_flags = context.options().get(debug_option);
     if (debug_flags & DebugFlags::Commands)
     {
         String repr_parameters;
@@ -467,21 +467,44 @@ void CommandManager::execute_single_command(CommandParameters params,
     }
 }
 
+RefPtr<CommandManager::ParsedCommandLine>
+CommandManager::parse_command_line(StringView command_line)
+{
+    // long command lines are usually sourced files, run only once
+    constexpr ByteCount max_cached_length = 8192;
+    constexpr size_t max_cached_count = 1024;
+
+    auto it = m_parsed_command_lines.find(command_line);
+    if (it != m_parsed_command_lines.end())
+        return it->value;
+
+    RefPtr<ParsedCommandLine> parsed{new ParsedCommandLine{parse<true>(command_line)}};
+    if (command_line.length() > max_cached_length)
+        return parsed;
+
+    if (m_parsed_command_lines.size() >= max_cached_count)
+        m_parsed_command_lines.remove(String{m_parsed_command_lines.begin()->key});
+    m_parsed_command_lines.insert({command_line.str(), parsed});
+    return parsed;
+}
+
 void CommandManager::execute(StringView command_line,
                              Context& context, const ShellContext& shell_context)
 {
-    TokenList tokens = parse<true>(command_line);
+    // keep a reference, executing commands can evict it from the cache
+    auto parsed = parse_command_line(command_line);
+    auto& tokens = parsed->tokens;
     if (tokens.empty())
         return;
-    // Tokens are going to be read as a stack
-    std::reverse(tokens.begin(), tokens.end());
+
+    // Tokens from shell expansions are read as a stack, before the
+    // remaining parsed ones
+    Vector<Token> expanded_tokens;
+    size_t next_token = 0;
 
     DisplayCoord command_coord;
     Vector<String> params;
-    while (not tokens.empty())
-    {
-        Token token = std::move(tokens.back());
-        tokens.pop_back();
+    auto process_token = [&](const Token& token) {
         if (params.empty())
             command_coord = token.coord;
 
@@ -495,15 +518,27 @@ void CommandManager::execute(StringView command_line,
         {
             auto new_tokens = parse<true>(expand_token(token, context,
                                                        shell_context));
-            tokens.insert(tokens.end(),
-                          std::make_move_iterator(new_tokens.rbegin()),
-                          std::make_move_iterator(new_tokens.rend()));
+            expanded_tokens.insert(expanded_tokens.end(),
+                                   std::make_move_iterator(new_tokens.rbegin()),
+                                   std::make_move_iterator(new_tokens.rend()));
         }
         else if (token.type == Token::Type::ArgExpand and token.content == '@')
             params.insert(params.end(), shell_context.params.begin(),
                           shell_context.params.end());
         else
             params.push_back(expand_token(token, context, shell_context));
+    };
+
+    while (not expanded_tokens.empty() or next_token != tokens.size())
+    {
+        if (expanded_tokens.empty())
+            process_token(tokens[next_token++]);
+        else
+        {
+            Token token = std::move(expanded_tokens.back());
+            expanded_tokens.pop_back();
+            process_token(token);
+        }
     }
     execute_single_command(params, context, shell_context, command_coord);
 }
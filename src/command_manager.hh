@@ -8,6 +8,7 @@
 #include "parameters_parser.hh"
 #include "string.hh"
 #include "optional.hh"
+#include "ref_ptr.hh"
 #include "utils.hh"
 #include "hash_map.hh"
 
@@ -115,6 +116,16 @@ private:
     String m_last_complete_command;
     int m_command_depth = 0;
 
+    // Hooks, mappings and commands bodies execute the same command lines
+    // repeatedly, their tokens are kept to avoid parsing them again.
+    struct ParsedCommandLine : RefCountable, UseMemoryDomain<MemoryDomain::Commands>
+    {
+        ParsedCommandLine(TokenList tokens) : tokens(std::move(tokens)) {}
+        const TokenList tokens;
+    };
+    RefPtr<ParsedCommandLine> parse_command_line(StringView command_line);
+    HashMap<String, RefPtr<ParsedCommandLine>, MemoryDomain::Commands> m_parsed_command_lines;
+
     CommandMap::const_iterator find_command(const Context& context,
                                             StringView name) const;
 };
@@ -11,6 +11,7 @@
 #include "event_manager.hh"
 #include "face_registry.hh"
 #include "file.hh"
+#include "file_index.hh"
 #include "hash_map.hh"
 #include "highlighter.hh"
 #include "highlighters.hh"
@@ -107,6 +108,24 @@ auto filename_completer = make_completer(
                                             context.options()["ignored_files"].get<Regex>(),
                                             cursor_pos, FilenameFlags::Expand) }; });
 
+auto edit_completer = make_completer(
+    [](const Context& context, CompletionFlags flags, const String& prefix, ByteCount cursor_pos)
+    {
+        auto& ignored_files = context.options()["ignored_files"].get<Regex>();
+        // absolute, home, explicitly relative or environment variable paths
+        // are still completed directory by directory
+        if (context.options()["edit_completion"].get<EditCompletion>() == EditCompletion::Project and
+            ProjectFileIndex::has_instance() and
+            (prefix.empty() or not contains(StringView{"/~.$"}, prefix[0_byte])))
+            return Completions{ 0_byte, cursor_pos,
+                                ProjectFileIndex::instance().complete(prefix.substr(0, cursor_pos),
+                                                                      ignored_files) };
+
+        return Completions{ 0_byte, cursor_pos,
+                            complete_filename(prefix, ignored_files, cursor_pos,
+                                              FilenameFlags::Expand) };
+    });
+
 static Completions complete_buffer_name(const Context& context, CompletionFlags flags,
                                         StringView prefix, ByteCount cursor_pos)
 {
@@ -138,8 +157,8 @@ static Completions complete_buffer_name(const Context& context, CompletionFlags
         if (RankedMatch match{bufname, query})
             matches.emplace_back(match, buffer.get());
     }
-    std::sort(filename_matches.begin(), filename_matches.end());
-    std::sort(matches.begin(), matches.end());
+    keep_best_matches(filename_matches);
+    keep_best_matches(matches, max_completion_candidates - filename_matches.size());
 
     CandidateList res;
     for (auto& match : filename_matches)
@@ -284,7 +303,7 @@ const CommandDesc edit_cmd = {
     edit_params,
     CommandFlags::None,
     CommandHelper{},
-    filename_completer,
+    edit_completer,
     edit<false>
 };
 
@@ -296,7 +315,7 @@ const CommandDesc force_edit_cmd = {
     edit_params,
     CommandFlags::None,
     CommandHelper{},
-    filename_completer,
+    edit_completer,
     edit<true>
 };
 
@@ -1130,7 +1149,7 @@ const CommandDesc debug_cmd = {
     "debug",
     nullptr,
     "debug <command>: write some debug informations in the debug buffer\n"
-    "existing commands: info, buffers, options, memory, shared-strings, profile-hash-maps, faces",
+    "existing commands: info, buffers, options, memory, shared-strings, profile-hash-maps, faces, regex, project-index",
     ParameterDesc{{}, ParameterDesc::Flags::SwitchesOnlyAtStart, 1},
     CommandFlags::None,
     CommandHelper{},
@@ -1138,7 +1157,7 @@ const CommandDesc debug_cmd = {
         [](const Context& context, CompletionFlags flags,
            const String& prefix, ByteCount cursor_pos) -> Completions {
                auto c = {"info", "buffers", "options", "memory", "shared-strings",
-                         "profile-hash-maps", "faces", "mappings"};
+                         "profile-hash-maps", "faces", "mappings", "regex", "project-index"};
                return { 0_byte, cursor_pos, complete(prefix, cursor_pos, c) };
     }),
     [](const ParametersParser& parser, Context& context, const ShellContext&)
@@ -1188,6 +1207,17 @@ const CommandDesc debug_cmd = {
         {
             profile_hash_maps();
         }
+        else if (parser[0] == "regex")
+        {
+            regex_cache_debug_stats();
+        }
+        else if (parser[0] == "project-index")
+        {
+            auto& index = ProjectFileIndex::instance();
+            index.finish_walk();
+            write_to_debug_buffer(format("Project file index: {} files, {} watched directories",
+                                         index.file_count(), index.watched_directory_count()));
+        }
         else if (parser[0] == "faces")
         {
             write_to_debug_buffer("Faces:");
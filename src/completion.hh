@@ -68,13 +68,11 @@ CandidateList complete(StringView query, ByteCount cursor_pos,
                   "complete require long lived strings, not temporaries");
 
     query = query.substr(0, cursor_pos);
-    Vector<RankedMatch> matches;
+    Vector<StringView> strings;
     for (const auto& str : container)
-    {
-        if (RankedMatch match{str, query})
-            matches.push_back(match);
-    }
-    std::sort(matches.begin(), matches.end());
+        strings.push_back(str);
+    auto matches = ranked_matches(strings, query);
+    keep_best_matches(matches);
     CandidateList res;
     for (auto& m : matches)
         res.push_back(m.candidate().str());
@@ -74,6 +74,13 @@ void Context::print_status(DisplayLine status, bool immediate) const
 {
     if (has_client())
         client().print_status(std::move(status), immediate);
+    else if (m_status_output)
+    {
+        if (not m_status_output->empty())
+            *m_status_output += '\n';
+        for (auto& atom : status)
+            *m_status_output += atom.content();
+    }
 }
 
 void JumpList::push(SelectionList jump)
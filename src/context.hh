@@ -97,6 +97,8 @@ public:
     AliasRegistry& aliases() const { return scope().aliases(); }
 
     void print_status(DisplayLine status, bool immediate = false) const;
+    // When there is no client, status lines get appended to output, if set
+    void set_status_output(String* output) { m_status_output = output; }
 
     StringView main_sel_register_value(StringView reg) const;
 
@@ -141,6 +143,7 @@ private:
     Optional<SelectionList> m_selections;
 
     String m_name;
+    String* m_status_output = nullptr;
 
     JumpList m_jump_list;
 
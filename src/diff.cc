@@ -0,0 +1,116 @@
+#include "diff.hh"
+
+#include <algorithm>
+
+namespace Kakoune
+{
+
+// Below that length, the O(ND) algorithm is fast enough and gives smaller
+// diffs than splitting on unique ids.
+constexpr int patience_min_length = 1024;
+
+namespace
+{
+
+struct Anchor
+{
+    int posA, posB;
+};
+
+struct PatienceDiff
+{
+    const int* a;
+    const int* b;
+    Vector<int> count_a, count_b, pos_a;
+    Vector<Diff>& diffs;
+
+    void diff(int begA, int endA, int begB, int endB);
+    Vector<Anchor> find_anchors(int begA, int endA, int begB, int endB);
+};
+
+Vector<Anchor> PatienceDiff::find_anchors(int begA, int endA, int begB, int endB)
+{
+    for (int i = begA; i < endA; ++i)
+    {
+        ++count_a[a[i]];
+        pos_a[a[i]] = i;
+    }
+    for (int i = begB; i < endB; ++i)
+        ++count_b[b[i]];
+
+    // ids unique in both ranges, in b order
+    Vector<Anchor> candidates;
+    for (int i = begB; i < endB; ++i)
+    {
+        const int id = b[i];
+        if (count_a[id] == 1 and count_b[id] == 1)
+            candidates.push_back({pos_a[id], i});
+    }
+
+    for (int i = begA; i < endA; ++i)
+        count_a[a[i]] = 0;
+    for (int i = begB; i < endB; ++i)
+        count_b[b[i]] = 0;
+
+    // keep the longest subsequence of candidates that is also in a order,
+    // found by patience sorting
+    Vector<int> tails;
+    Vector<int> previous(candidates.size(), -1);
+    for (int i = 0; i < (int)candidates.size(); ++i)
+    {
+        auto it = std::lower_bound(tails.begin(), tails.end(), candidates[i].posA,
+                                   [&](int index, int posA) { return candidates[index].posA < posA; });
+        if (it != tails.begin())
+            previous[i] = *(it-1);
+        if (it == tails.end())
+            tails.push_back(i);
+        else
+            *it = i;
+    }
+
+    Vector<Anchor> anchors(tails.size());
+    for (int i = tails.empty() ? -1 : tails.back(), j = (int)tails.size() - 1; i != -1; i = previous[i], --j)
+        anchors[j] = candidates[i];
+    return anchors;
+}
+
+void PatienceDiff::diff(int begA, int endA, int begB, int endB)
+{
+    auto ends = find_common_ends(a, begA, endA, b, begB, endB, std::equal_to<>{});
+    begA += ends.prefix_len, begB += ends.prefix_len;
+    endA -= ends.suffix_len, endB -= ends.suffix_len;
+
+    append_diff(diffs, {Diff::Keep, ends.prefix_len, 0});
+
+    auto anchors = (endA - begA) + (endB - begB) >= patience_min_length and begA != endA and begB != endB
+        ? find_anchors(begA, endA, begB, endB) : Vector<Anchor>{};
+
+    if (anchors.empty())
+        find_diff_range(a, begA, endA, b, begB, endB, std::equal_to<>{}, diffs);
+    else
+    {
+        for (auto& anchor : anchors)
+        {
+            diff(begA, anchor.posA, begB, anchor.posB);
+            append_diff(diffs, {Diff::Keep, 1, 0});
+            begA = anchor.posA + 1;
+            begB = anchor.posB + 1;
+        }
+        diff(begA, endA, begB, endB);
+    }
+
+    append_diff(diffs, {Diff::Keep, ends.suffix_len, 0});
+}
+
+}
+
+void find_diff_ids(const int* a, int begA, int endA,
+                   const int* b, int begB, int endB,
+                   int id_count, Vector<Diff>& diffs)
+{
+    PatienceDiff patience{a, b, Vector<int>(id_count, 0), Vector<int>(id_count, 0),
+                          Vector<int>(id_count, 0), diffs};
+    patience.diff(begA, endA, begB, endB);
+}
+
+}
@@ -168,14 +168,112 @@ void find_diff_rec(Iterator a, int begA, int endA,
     append_diff(diffs, {Diff::Keep, suffix_len, 0});
 }
 
+struct CommonEnds
+{
+    int prefix_len, suffix_len;
+};
+
+template<typename Iterator, typename Equal>
+CommonEnds find_common_ends(Iterator a, int begA, int endA,
+                            Iterator b, int begB, int endB, Equal eq)
+{
+    int prefix_len = 0;
+    while (begA + prefix_len != endA and begB + prefix_len != endB and
+           eq(a[begA + prefix_len], b[begB + prefix_len]))
+        ++prefix_len;
+
+    int suffix_len = 0;
+    while (begA + prefix_len + suffix_len != endA and begB + prefix_len + suffix_len != endB and
+           eq(a[endA-1-suffix_len], b[endB-1-suffix_len]))
+        ++suffix_len;
+
+    return {prefix_len, suffix_len};
+}
+
+template<typename Iterator, typename Equal>
+void find_diff_range(Iterator a, int begA, int endA,
+                     Iterator b, int begB, int endB,
+                     Equal eq, Vector<Diff>& diffs)
+{
+    // trim the common prefix and suffix first, so that the V arrays
+    // only need to cover the part that differs
+    auto ends = find_common_ends(a, begA, endA, b, begB, endB, eq);
+    begA += ends.prefix_len, begB += ends.prefix_len;
+    endA -= ends.suffix_len, endB -= ends.suffix_len;
+
+    const int len = (endA - begA) + (endB - begB);
+    const int max = 2 * len + 1;
+    Vector<int> data(2*max);
+    constexpr int cost_limit = 1000;
+    append_diff(diffs, {Diff::Keep, ends.prefix_len, 0});
+    find_diff_rec(a, begA, endA, b, begB, endB,
+                  &data[len], &data[max + len], cost_limit, eq, diffs);
+    append_diff(diffs, {Diff::Keep, ends.suffix_len, 0});
+}
+
 template<typename Iterator, typename Equal = std::equal_to<>>
 Vector<Diff> find_diff(Iterator a, int N, Iterator b, int M, Equal eq = Equal{})
 {
-    const int max = 2 * (N + M) + 1;
-    Vector<int> data(2*max);
     Vector<Diff> diffs;
-    constexpr int cost_limit = 1000;
-    find_diff_rec(a, 0, N, b, 0, M, &data[N+M], &data[max + N+M], cost_limit, eq, diffs);
+    find_diff_range(a, 0, N, b, 0, M, eq, diffs);
+    return diffs;
+}
+
+// Diff the sequences of ids a[begA..endA) and b[begB..endB), ids being in
+// [0, id_count). Large inputs are split on the ids appearing only once in
+// both sequences (patience diff) and the remaining parts diffed as above.
+void find_diff_ids(const int* a, int begA, int endA,
+                   const int* b, int begB, int endB,
+                   int id_count, Vector<Diff>& diffs);
+
+// Diff sequences whose elements are costly to compare, such as lines.
+//
+// Each element of the part that differs is given an id shared with the
+// elements equal to it, found through its hash, so that the diff itself
+// only compares integers.
+template<typename Iterator, typename Hash, typename Equal = std::equal_to<>>
+Vector<Diff> find_hashed_diff(Iterator a, int N, Iterator b, int M, Hash hash, Equal eq = Equal{})
+{
+    const auto ends = find_common_ends(a, 0, N, b, 0, M, eq);
+    const int prefix_len = ends.prefix_len, suffix_len = ends.suffix_len;
+
+    const int count = N + M - 2 * (prefix_len + suffix_len);
+    size_t bucket_count = 16;
+    while (bucket_count < 2 * (size_t)count)
+        bucket_count *= 2;
+    const size_t mask = bucket_count - 1;
+
+    struct Class { size_t hash; Iterator element; };
+    Vector<Class> classes;
+    Vector<int> buckets(bucket_count, -1);
+    auto classify = [&](Iterator it) {
+        const size_t h = hash(*it);
+        for (size_t slot = h & mask; ; slot = (slot + 1) & mask)
+        {
+            int& id = buckets[slot];
+            if (id == -1)
+            {
+                id = (int)classes.size();
+                classes.push_back({h, it});
+                return id;
+            }
+            if (classes[id].hash == h and eq(*classes[id].element, *it))
+                return id;
+        }
+    };
+
+    Vector<int> ids(N + M, 0);
+    for (int i = prefix_len; i < N - suffix_len; ++i)
+        ids[i] = classify(a + i);
+    for (int i = prefix_len; i < M - suffix_len; ++i)
+        ids[N + i] = classify(b + i);
+
+    Vector<Diff> diffs;
+    append_diff(diffs, {Diff::Keep, prefix_len, 0});
+    find_diff_ids(ids.data(), prefix_len, N - suffix_len,
+                  ids.data() + N, prefix_len, M - suffix_len,
+                  (int)classes.size(), diffs);
+    append_diff(diffs, {Diff::Keep, suffix_len, 0});
 
     return diffs;
 }
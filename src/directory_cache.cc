@@ -0,0 +1,151 @@
+#include "directory_cache.hh"
+
+#include "file.hh"
+#include "file_watcher.hh"
+#include "ranges.hh"
+#include "string_utils.hh"
+
+#include <cstdio>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#if defined(__APPLE__)
+#define st_mtim st_mtimespec
+#endif
+
+namespace Kakoune
+{
+
+DirectoryEntryType directory_entry_type(StringView directory, const dirent& entry,
+                                        bool follow_directory_links)
+{
+#if defined(DT_DIR)
+    if (entry.d_type == DT_DIR)
+        return DirectoryEntryType::Directory;
+    if (entry.d_type != DT_LNK and entry.d_type != DT_UNKNOWN)
+        return DirectoryEntryType::File;
+#endif
+
+    char path[PATH_MAX+1];
+    const bool add_slash = not directory.empty() and directory.back() != '/';
+    if (snprintf(path, sizeof(path), "%.*s%s%s", (int)directory.length(), directory.data(),
+                 add_slash ? "/" : "", entry.d_name) >= (int)sizeof(path))
+        return DirectoryEntryType::Skipped;
+
+    struct stat st;
+    if (lstat(path, &st) != 0)
+        return DirectoryEntryType::Skipped;
+    if (S_ISLNK(st.st_mode) and
+        (stat(path, &st) != 0 or (S_ISDIR(st.st_mode) and not follow_directory_links)))
+        return DirectoryEntryType::Skipped;
+
+    return S_ISDIR(st.st_mode) ? DirectoryEntryType::Directory : DirectoryEntryType::File;
+}
+
+DirectoryEntries read_directory(StringView directory)
+{
+    DIR* dir = opendir(directory.empty() ? "./" : directory.zstr());
+    if (not dir)
+        return {};
+
+    auto close_dir = on_scope_end([dir]{ closedir(dir); });
+
+    DirectoryEntries result;
+    while (dirent* entry = readdir(dir))
+    {
+        StringView filename = entry->d_name;
+        if (filename.empty())
+            continue;
+
+        switch (directory_entry_type(directory, *entry, true))
+        {
+            case DirectoryEntryType::Directory: result.push_back({filename + "/"}); break;
+            case DirectoryEntryType::File: result.push_back({filename.str()}); break;
+            case DirectoryEntryType::Skipped: break;
+        }
+    }
+    return result;
+}
+
+DirectoryCache::~DirectoryCache()
+{
+    if (not FileWatcher::has_instance())
+        return;
+    for (auto& listing : m_listings)
+        FileWatcher::instance().unwatch_directory(listing.value.watch);
+}
+
+void DirectoryCache::drop_listing(StringView path)
+{
+    auto it = m_listings.find(path);
+    if (it == m_listings.end())
+        return;
+    if (FileWatcher::has_instance())
+        FileWatcher::instance().unwatch_directory(it->value.watch);
+    m_listings.remove(path);
+}
+
+ConstArrayView<DirectoryEntry> DirectoryCache::entries(StringView directory)
+{
+    String path;
+    if (not directory.empty() and directory[0_byte] == '/')
+        path = directory.str();
+    else
+    {
+        char cwd[PATH_MAX+1];
+        if (not getcwd(cwd, sizeof(cwd)))
+            return {};
+        path = format("{}/{}", cwd, directory);
+    }
+    if (path.back() != '/')
+        path += '/';
+
+    if (FileWatcher::has_instance())
+        FileWatcher::instance().read_events();
+
+    auto it = m_listings.find(path);
+    if (it != m_listings.end() and it->value.watch != -1)
+        return it->value.entries;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 or not S_ISDIR(st.st_mode))
+    {
+        drop_listing(path);
+        return {};
+    }
+
+    if (it != m_listings.end())
+    {
+        if (it->value.mtime == st.st_mtim)
+            return it->value.entries;
+        drop_listing(path);
+    }
+
+    if (m_listings.size() >= max_listings)
+        drop_listing(String{m_listings.begin()->key});
+
+    // Entries created while reading are seen by the watch added first
+    int watch = -1;
+#if defined(__linux__)
+    if (FileWatcher::has_instance())
+        watch = FileWatcher::instance().watch_directory(
+            path, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF,
+            [this, path](int mask, StringView) {
+                // other watchers of that directory can ask for more events
+                if (mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                            IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_Q_OVERFLOW))
+                    drop_listing(path);
+            });
+#endif
+
+    auto entries = read_directory(path);
+    return m_listings.insert({std::move(path), {watch, st.st_mtim, std::move(entries)}}).entries;
+}
+
+}
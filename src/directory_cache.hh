@@ -0,0 +1,78 @@
+#ifndef directory_cache_hh_INCLUDED
+#define directory_cache_hh_INCLUDED
+
+#include "array_view.hh"
+#include "hash_map.hh"
+#include "string.hh"
+#include "utils.hh"
+#include "vector.hh"
+
+#include <time.h>
+
+struct dirent;
+
+namespace Kakoune
+{
+
+struct DirectoryEntry
+{
+    String name; // directories get a trailing '/'
+
+    bool is_directory() const { return name.back() == '/'; }
+    // name without the trailing '/' of directories
+    StringView filename() const { return is_directory() ? name.substr(0, name.length()-1) : name; }
+};
+
+using DirectoryEntries = Vector<DirectoryEntry, MemoryDomain::Completion>;
+
+enum class DirectoryEntryType
+{
+    Skipped,
+    File,
+    Directory
+};
+
+// Type of an entry read from directory, using the type returned by readdir
+// and only calling stat for symbolic links and unknown types. Dangling
+// symbolic links are skipped, as are links to directories unless
+// follow_directory_links is true. Safe to call from any thread.
+DirectoryEntryType directory_entry_type(StringView directory, const dirent& entry,
+                                        bool follow_directory_links);
+
+// Read the entries of directory, following symbolic links
+DirectoryEntries read_directory(StringView directory);
+
+// Cache of directory listings, so that filename completion does not read
+// the same directories on every key press.
+//
+// Cached directories are watched through the FileWatcher when available, the
+// listing is dropped as soon as an entry is created, deleted or renamed. When
+// the directory cannot be watched, its modification time is checked instead.
+class DirectoryCache : public Singleton<DirectoryCache>
+{
+public:
+    ~DirectoryCache();
+
+    // Returns the entries of directory, relative paths are resolved against
+    // the current working directory. The returned view is valid until the
+    // next call.
+    ConstArrayView<DirectoryEntry> entries(StringView directory);
+
+private:
+    struct Listing
+    {
+        int watch;
+        timespec mtime;
+        DirectoryEntries entries;
+    };
+
+    void drop_listing(StringView path);
+
+    static constexpr int max_listings = 64;
+
+    HashMap<String, Listing, MemoryDomain::Completion> m_listings;
+};
+
+}
+
+#endif // directory_cache_hh_INCLUDED
@@ -6,6 +6,7 @@
 #include "utf8.hh"
 
 #include "face_registry.hh"
+#include "unit_tests.hh"
 
 namespace Kakoune
 {
@@ -328,4 +329,100 @@ String fix_atom_text(StringView str)
     return res;
 }
 
+size_t hash_value(const DisplayAtom& atom)
+{
+    return hash_values(atom.content(), atom.face);
+}
+
+size_t hash_value(const DisplayLine& line)
+{
+    size_t hash = line.atoms().size();
+    for (auto& atom : line)
+        hash = combine_hash(hash, hash_value(atom));
+    return hash;
+}
+
+bool same_display(const DisplayLine& lhs, const DisplayLine& rhs)
+{
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      [](const DisplayAtom& lhs, const DisplayAtom& rhs) {
+                          return lhs.face == rhs.face and lhs.content() == rhs.content();
+                      });
+}
+
+Vector<int> LineDamageTracker::update(ConstArrayView<DisplayLine> lines)
+{
+    HashMap<size_t, int, MemoryDomain::Display> old_indices;
+    for (int i = 0; i < m_hashes.size(); ++i)
+    {
+        if (not old_indices.contains(m_hashes[i]))
+            old_indices.insert({m_hashes[i], i});
+    }
+
+    Vector<int> matches;
+    Vector<DisplayLine, MemoryDomain::Display> new_lines;
+    Vector<size_t, MemoryDomain::Display> new_hashes;
+    matches.reserve(lines.size());
+    new_lines.reserve(lines.size());
+    new_hashes.reserve(lines.size());
+
+    auto matches_old = [&](int index, size_t hash, const DisplayLine& line) {
+        return index >= 0 and index < m_hashes.size() and m_hashes[index] == hash and
+               same_display(m_lines[index], line);
+    };
+
+    int previous = -1;
+    for (auto& line : lines)
+    {
+        const size_t hash = hash_value(line);
+        int match = -1;
+        if (previous != -1 and matches_old(previous + 1, hash, line))
+            match = previous + 1;
+        else
+        {
+            auto it = old_indices.find(hash);
+            if (it != old_indices.end() and matches_old(it->value, hash, line))
+                match = it->value;
+        }
+
+        if (match != -1)
+            new_lines.push_back(m_lines[match]);
+        else
+        {
+            AtomList atoms;
+            atoms.reserve(line.atoms().size());
+            for (auto& atom : line)
+                atoms.push_back({atom.content().str(), atom.face});
+            new_lines.push_back(DisplayLine{std::move(atoms)});
+        }
+        new_hashes.push_back(hash);
+        matches.push_back(match);
+        previous = match;
+    }
+
+    m_lines = std::move(new_lines);
+    m_hashes = std::move(new_hashes);
+    return matches;
+}
+
+UnitTest test_line_damage_tracker{[]()
+{
+    auto frame = [](std::initializer_list<const char*> contents) {
+        Vector<DisplayLine> lines;
+        for (auto& content : contents)
+            lines.push_back(DisplayLine{content});
+        return lines;
+    };
+
+    LineDamageTracker tracker;
+    kak_assert((tracker.update(frame({"a", "b", "c"})) == Vector<int>{-1, -1, -1}));
+    kak_assert((tracker.update(frame({"a", "b", "c"})) == Vector<int>{0, 1, 2}));
+    kak_assert((tracker.update(frame({"b", "c", "d"})) == Vector<int>{1, 2, -1}));
+    kak_assert((tracker.update(frame({"x", "c", "d"})) == Vector<int>{-1, 1, 2}));
+
+    auto lines = frame({"x", "c", "d"});
+    lines[1].begin()->face = Face{Color::Red};
+    kak_assert((tracker.update(lines) == Vector<int>{0, -1, 2}));
+}};
+
 }
@@ -142,6 +142,12 @@ private:
     AtomList  m_atoms;
 };
 
+size_t hash_value(const DisplayAtom& atom);
+size_t hash_value(const DisplayLine& line);
+
+// Compares displayed content and faces, regardless of atom types
+bool same_display(const DisplayLine& lhs, const DisplayLine& rhs);
+
 String fix_atom_text(StringView str);
 DisplayLine parse_display_line(StringView line, const HashMap<String, DisplayLine>& builtins = {});
 
@@ -166,6 +172,25 @@ private:
     BufferRange m_range;
 };
 
+// Keeps a copy of the last drawn lines, so that user interfaces can
+// only redraw or transmit the lines that changed.
+class LineDamageTracker
+{
+public:
+    // For each line, returns the index of an identical line in the previous
+    // frame, or -1 if it needs to be drawn. Matching lines following a match
+    // are preferred, so that scrolled regions map to contiguous ranges.
+    // lines then become the previous frame.
+    Vector<int> update(ConstArrayView<DisplayLine> lines);
+
+    void reset() { m_lines.clear(); m_hashes.clear(); }
+
+private:
+    // text copies, as buffer ranges might be invalidated
+    Vector<DisplayLine, MemoryDomain::Display> m_lines;
+    Vector<size_t, MemoryDomain::Display> m_hashes;
+};
+
 }
 
 #endif // display_buffer_hh_INCLUDED
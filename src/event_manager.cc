@@ -5,18 +5,32 @@
 
 #include <unistd.h>
 
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <pthread.h>
+#define KAK_HAVE_EPOLL
+#endif
+
 namespace Kakoune
 {
 
 FDWatcher::FDWatcher(int fd, FdEvents events, Callback callback)
     : m_fd{fd}, m_events{events}, m_callback{std::move(callback)}
 {
-    EventManager::instance().m_fd_watchers.push_back(this);
+    EventManager::instance().add_watcher(*this);
 }
 
 FDWatcher::~FDWatcher()
 {
-    unordered_erase(EventManager::instance().m_fd_watchers, this);
+    EventManager::instance().remove_watcher(*this);
+}
+
+void FDWatcher::set_events(FdEvents events)
+{
+    if (events == m_events)
+        return;
+    m_events = events;
+    EventManager::instance().update_watcher(*this);
 }
 
 void FDWatcher::run(FdEvents events, EventMode mode)
@@ -28,22 +42,36 @@ void FDWatcher::close_fd()
 {
     if (m_fd != -1)
     {
-        close(m_fd);
-        m_fd = -1;
+        const int fd = m_fd;
+        disable(); // unregister before closing, so the fd can get reused
+        close(fd);
     }
 }
 
+void FDWatcher::disable()
+{
+    m_fd = -1;
+    EventManager::instance().update_watcher(*this);
+}
+
 Timer::Timer(TimePoint date, Callback callback, EventMode mode)
     : m_date{date}, m_callback{std::move(callback)}, m_mode(mode)
 {
     if (m_callback and EventManager::has_instance())
-        EventManager::instance().m_timers.push_back(this);
+        EventManager::instance().add_timer(*this);
 }
 
 Timer::~Timer()
 {
-    if (m_callback and EventManager::has_instance())
-        unordered_erase(EventManager::instance().m_timers, this);
+    if (m_heap_index != not_scheduled)
+        EventManager::instance().remove_timer(*this);
+}
+
+void Timer::set_next_date(TimePoint date)
+{
+    m_date = date;
+    if (m_heap_index != not_scheduled)
+        EventManager::instance().update_timer(*this);
 }
 
 void Timer::run(EventMode mode)
@@ -51,26 +79,280 @@ void Timer::run(EventMode mode)
     kak_assert(m_callback);
     if (mode == m_mode)
     {
-        m_date = TimePoint::max();
+        set_next_date(TimePoint::max());
         m_callback(*this);
     }
     else // try again a little later
-        m_date = Clock::now() + std::chrono::milliseconds{10};
+        set_next_date(Clock::now() + std::chrono::milliseconds{10});
+}
+
+IdleTask::IdleTask(Callback callback, int priority)
+    : m_priority{priority}, m_callback{std::move(callback)}
+{
+}
+
+IdleTask::~IdleTask()
+{
+    cancel();
+}
+
+void IdleTask::schedule()
+{
+    if (m_scheduled or not EventManager::has_instance())
+        return;
+
+    auto& tasks = EventManager::instance().m_idle_tasks;
+    auto it = std::find_if(tasks.begin(), tasks.end(),
+                           [this](IdleTask* t) { return t->m_priority < m_priority; });
+    tasks.insert(it, this);
+    m_scheduled = true;
+}
+
+void IdleTask::cancel()
+{
+    if (not m_scheduled)
+        return;
+
+    auto& tasks = EventManager::instance().m_idle_tasks;
+    tasks.erase(find(tasks, this));
+    m_scheduled = false;
+}
+
+bool IdleTask::run()
+{
+    kak_assert(m_scheduled);
+    if (m_callback(*this))
+        return true;
+    cancel();
+    return false;
+}
+
+#if defined(KAK_HAVE_EPOLL)
+// the epoll set is shared with forked processes, which must not
+// modify it, so they lazily create their own before using it.
+static bool epoll_set_inherited = false;
+
+static uint32_t to_epoll_events(FdEvents events)
+{
+    return (events & FdEvents::Read ? (uint32_t)EPOLLIN : 0u) |
+           (events & FdEvents::Write ? (uint32_t)EPOLLOUT : 0u) |
+           (events & FdEvents::Except ? (uint32_t)EPOLLPRI : 0u);
 }
+#endif
 
 EventManager::EventManager()
 {
     FD_ZERO(&m_forced_fd);
+#if defined(KAK_HAVE_EPOLL)
+    static bool atfork_registered = false;
+    if (not atfork_registered)
+    {
+        pthread_atfork(nullptr, nullptr, [] { epoll_set_inherited = true; });
+        atfork_registered = true;
+    }
+    epoll_set_inherited = false;
+    // on failure, m_epoll_fd stays -1 and we fall back to pselect
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+#endif
 }
 
 EventManager::~EventManager()
 {
     kak_assert(m_fd_watchers.empty());
     kak_assert(m_timers.empty());
+    kak_assert(m_idle_tasks.empty());
+    if (m_epoll_fd != -1)
+        close(m_epoll_fd);
+}
+
+void EventManager::add_watcher(FDWatcher& watcher)
+{
+    watcher.m_index = m_fd_watchers.size();
+    m_fd_watchers.push_back(&watcher);
+    update_watcher(watcher);
+}
+
+void EventManager::remove_watcher(FDWatcher& watcher)
+{
+    unpoll_watcher(watcher);
+
+    kak_assert(m_fd_watchers[watcher.m_index] == &watcher);
+    FDWatcher* last = m_fd_watchers.back();
+    m_fd_watchers[watcher.m_index] = last;
+    last->m_index = watcher.m_index;
+    m_fd_watchers.pop_back();
+}
+
+void EventManager::update_watcher(FDWatcher& watcher)
+{
+#if defined(KAK_HAVE_EPOLL)
+    if (m_epoll_fd == -1)
+        return;
+    if (epoll_set_inherited)
+        return reset_epoll();
+
+    const int fd = watcher.m_fd;
+    const FdEvents events = watcher.m_events;
+    if (watcher.m_polled_fd != fd or fd == -1 or events == FdEvents::None)
+        unpoll_watcher(watcher);
+    else if (watcher.m_polled_events == events or watcher.m_always_ready)
+        return;
+
+    if (fd == -1 or events == FdEvents::None)
+        return;
+
+    epoll_event event{to_epoll_events(events), {}};
+    event.data.fd = fd;
+    int res = epoll_ctl(m_epoll_fd, watcher.m_polled_fd == fd ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+    if (res != 0 and errno == EEXIST) // stale registration, fd was closed behind our back and reused
+        res = epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+
+    if (res == 0)
+    {
+        if (m_polled_watchers.size() <= fd)
+            m_polled_watchers.resize(fd + 1, nullptr);
+        m_polled_watchers[fd] = &watcher;
+        watcher.m_polled_fd = fd;
+        watcher.m_polled_events = events;
+    }
+    else if (errno == EPERM) // regular files cannot be polled, but are always ready
+    {
+        watcher.m_always_ready = true;
+        m_always_ready_watchers.push_back(&watcher);
+    }
+#endif
+}
+
+void EventManager::unpoll_watcher(FDWatcher& watcher)
+{
+#if defined(KAK_HAVE_EPOLL)
+    if (watcher.m_always_ready)
+    {
+        unordered_erase(m_always_ready_watchers, &watcher);
+        watcher.m_always_ready = false;
+    }
+
+    const int fd = watcher.m_polled_fd;
+    if (fd == -1)
+        return;
+
+    if (m_polled_watchers[fd] == &watcher)
+    {
+        m_polled_watchers[fd] = nullptr;
+        if (not epoll_set_inherited)
+            epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    watcher.m_polled_fd = -1;
+    watcher.m_polled_events = FdEvents::None;
+#endif
+}
+
+void EventManager::reset_epoll()
+{
+#if defined(KAK_HAVE_EPOLL)
+    epoll_set_inherited = false;
+    close(m_epoll_fd);
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    m_polled_watchers.clear();
+    m_always_ready_watchers.clear();
+    for (auto& watcher : m_fd_watchers)
+    {
+        watcher->m_polled_fd = -1;
+        watcher->m_polled_events = FdEvents::None;
+        watcher->m_always_ready = false;
+        update_watcher(*watcher);
+    }
+#endif
+}
+
+void EventManager::add_timer(Timer& timer)
+{
+    timer.m_heap_index = m_timers.size();
+    m_timers.push_back(&timer);
+    update_timer(timer);
+}
+
+void EventManager::remove_timer(Timer& timer)
+{
+    const size_t index = timer.m_heap_index;
+    kak_assert(m_timers[index] == &timer);
+    timer.m_heap_index = Timer::not_scheduled;
+
+    Timer* last = m_timers.back();
+    m_timers.pop_back();
+    if (last != &timer)
+    {
+        m_timers[index] = last;
+        last->m_heap_index = index;
+        update_timer(*last);
+    }
+}
+
+void EventManager::update_timer(Timer& timer)
+{
+    auto swap_timers = [this](size_t lhs, size_t rhs) {
+        std::swap(m_timers[lhs], m_timers[rhs]);
+        m_timers[lhs]->m_heap_index = lhs;
+        m_timers[rhs]->m_heap_index = rhs;
+    };
+
+    size_t index = timer.m_heap_index;
+    while (index > 0 and timer.m_date < m_timers[(index - 1) / 2]->m_date)
+    {
+        swap_timers(index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+
+    while (true)
+    {
+        size_t smallest = index;
+        for (auto child : { 2 * index + 1, 2 * index + 2 })
+        {
+            if (child < m_timers.size() and m_timers[child]->m_date < m_timers[smallest]->m_date)
+                smallest = child;
+        }
+        if (smallest == index)
+            break;
+        swap_timers(index, smallest);
+        index = smallest;
+    }
 }
 
 void EventManager::handle_next_events(EventMode mode, sigset_t* sigmask)
 {
+    const bool run_idle = mode == EventMode::Normal and not m_idle_tasks.empty();
+
+    bool with_timeout = false;
+    timespec ts{};
+    if (m_has_forced_fd or run_idle) // only check for pending events
+        with_timeout = true;
+    else if (not m_timers.empty() and m_timers.front()->next_date() != TimePoint::max())
+    {
+        with_timeout = true;
+        using namespace std::chrono; using ns = std::chrono::nanoseconds;
+        auto nsecs = std::max(ns(0), duration_cast<ns>(m_timers.front()->next_date() - Clock::now()));
+        auto secs = duration_cast<seconds>(nsecs);
+        ts = timespec{ (time_t)secs.count(), (long)(nsecs - secs).count() };
+    }
+
+#if defined(KAK_HAVE_EPOLL)
+    if (m_epoll_fd != -1 and epoll_set_inherited)
+        reset_epoll();
+#endif
+
+    int handled = m_epoll_fd != -1 ? poll_epoll(mode, sigmask, with_timeout ? &ts : nullptr)
+                                    : poll_select(mode, sigmask, with_timeout ? &ts : nullptr);
+
+    handled += run_timers(mode);
+
+    if (run_idle and handled == 0)
+        run_idle_tasks();
+}
+
+int EventManager::poll_select(EventMode mode, sigset_t* sigmask, const timespec* timeout)
+{
+    int handled = 0;
     int max_fd = 0;
     fd_set rfds, wfds, efds;
     FD_ZERO(&rfds); FD_ZERO(&wfds); FD_ZERO(&efds);
@@ -90,31 +372,13 @@ void EventManager::handle_next_events(EventMode mode, sigset_t* sigmask)
         }
     }
 
-    bool with_timeout = false;
-    timespec ts{};
-    if (not m_timers.empty())
-    {
-        auto next_date = (*std::min_element(
-            m_timers.begin(), m_timers.end(), [](Timer* lhs, Timer* rhs) {
-                return lhs->next_date() < rhs->next_date();
-        }))->next_date();
-
-        if (next_date != TimePoint::max())
-        {
-            with_timeout = true;
-            using namespace std::chrono; using ns = std::chrono::nanoseconds;
-            auto nsecs = std::max(ns(0), duration_cast<ns>(next_date - Clock::now()));
-            auto secs = duration_cast<seconds>(nsecs);
-            ts = timespec{ (time_t)secs.count(), (long)(nsecs - secs).count() };
-        }
-    }
-    int res = pselect(max_fd + 1, &rfds, &wfds, &efds,
-                      with_timeout ? &ts : nullptr, sigmask);
+    int res = pselect(max_fd + 1, &rfds, &wfds, &efds, timeout, sigmask);
 
     // copy forced fds *after* select, so that signal handlers can write to
     // m_forced_fd, interupt select, and directly be serviced.
     fd_set forced = m_forced_fd;
     FD_ZERO(&m_forced_fd);
+    m_has_forced_fd = 0;
 
     for (int fd = 0; fd < max_fd + 1; ++fd)
     {
@@ -129,22 +393,132 @@ void EventManager::handle_next_events(EventMode mode, sigset_t* sigmask)
             auto it = find_if(m_fd_watchers,
                               [fd](const FDWatcher* w){return w->fd() == fd; });
             if (it != m_fd_watchers.end())
+            {
                 (*it)->run(events, mode);
+                ++handled;
+            }
         }
     }
+    return handled;
+}
 
-    TimePoint now = Clock::now();
-    auto timers = m_timers; // copy timers in case m_timers gets mutated
-    for (auto& timer : timers)
+int EventManager::poll_epoll(EventMode mode, sigset_t* sigmask, const timespec* timeout)
+{
+    int handled = 0;
+#if defined(KAK_HAVE_EPOLL)
+    int timeout_ms = -1;
+    if (not m_always_ready_watchers.empty())
+        timeout_ms = 0;
+    else if (timeout) // round up, to avoid spinning until a timer is due
+        timeout_ms = timeout->tv_sec * 1000 + (timeout->tv_nsec + 999999) / 1000000;
+
+    constexpr int max_events = 64;
+    epoll_event ready[max_events];
+    int res = epoll_pwait(m_epoll_fd, ready, max_events, timeout_ms, sigmask);
+
+    // see poll_select for why forced fds are read after waiting
+    fd_set forced = m_forced_fd;
+    const bool has_forced = m_has_forced_fd;
+    FD_ZERO(&m_forced_fd);
+    m_has_forced_fd = 0;
+
+    auto take_forced = [&](int fd) {
+        if (not has_forced or fd >= FD_SETSIZE or not FD_ISSET(fd, &forced))
+            return FdEvents::None;
+        FD_CLR(fd, &forced);
+        return FdEvents::Read;
+    };
+
+    struct Ready { int fd; uint32_t events; };
+    Ready ready_fds[max_events];
+    for (int i = 0; i < res; ++i)
+        ready_fds[i] = { ready[i].data.fd, ready[i].events };
+
+    // Watchers can get removed by the callbacks, so always look them up by fd
+    for (int i = 0; i < res; ++i)
+    {
+        const int fd = ready_fds[i].fd;
+        FDWatcher* watcher = fd < m_polled_watchers.size() ? m_polled_watchers[fd] : nullptr;
+        if (not watcher)
+            continue;
+
+        const uint32_t ev = ready_fds[i].events;
+        auto events = take_forced(fd) |
+                      (ev & EPOLLIN ? FdEvents::Read : FdEvents::None) |
+                      (ev & EPOLLOUT ? FdEvents::Write : FdEvents::None) |
+                      (ev & EPOLLPRI ? FdEvents::Except : FdEvents::None);
+        // like select, report errors as readiness so the watcher gets to see them
+        if (ev & (EPOLLERR | EPOLLHUP))
+            events |= (FdEvents)(watcher->events() & ~FdEvents::Except);
+
+        if (events != FdEvents::None)
+        {
+            watcher->run(events, mode);
+            ++handled;
+        }
+    }
+
+    if (not m_always_ready_watchers.empty())
     {
-        if (contains(m_timers, timer) and timer->next_date() <= now)
-            timer->run(mode);
+        auto always_ready = m_always_ready_watchers; // copy as callbacks can mutate it
+        for (auto& watcher : always_ready)
+        {
+            if (contains(m_always_ready_watchers, watcher))
+            {
+                watcher->run(take_forced(watcher->fd()) | watcher->events(), mode);
+                ++handled;
+            }
+        }
     }
+
+    if (has_forced)
+    {
+        for (int fd = 0; fd < FD_SETSIZE; ++fd)
+        {
+            if (not FD_ISSET(fd, &forced))
+                continue;
+            auto it = find_if(m_fd_watchers,
+                              [fd](const FDWatcher* w){return w->fd() == fd; });
+            if (it != m_fd_watchers.end())
+            {
+                (*it)->run(FdEvents::Read, mode);
+                ++handled;
+            }
+        }
+    }
+#endif
+    return handled;
+}
+
+int EventManager::run_timers(EventMode mode)
+{
+    // Bound the number of timers run, so that a timer rescheduling itself
+    // in the past cannot starve the event loop.
+    const TimePoint now = Clock::now();
+    int handled = 0;
+    for (size_t count = m_timers.size(); count > 0 and not m_timers.empty() and
+                                         m_timers.front()->next_date() <= now; --count, ++handled)
+        m_timers.front()->run(mode);
+    return handled;
+}
+
+void EventManager::run_idle_tasks()
+{
+    constexpr auto idle_time_slice = std::chrono::milliseconds{5};
+    const TimePoint deadline = Clock::now() + idle_time_slice;
+    // stop early if a timer gets due, so that idle work does not delay it
+    auto next_timer = m_timers.empty() ? TimePoint::max() : m_timers.front()->next_date();
+    do
+    {
+        m_idle_tasks.front()->run();
+    }
+    while (not m_idle_tasks.empty() and Clock::now() < std::min(deadline, next_timer));
 }
 
 void EventManager::force_signal(int fd)
 {
     FD_SET(fd, &m_forced_fd);
+    m_has_forced_fd = 1;
 }
 
 SignalHandler set_signal_handler(int signum, SignalHandler handler)
@@ -157,4 +531,5 @@ SignalHandler set_signal_handler(int signum, SignalHandler handler)
     sigaction(signum, &new_action, &old_action);
     return old_action.sa_handler;
 }
+
 }
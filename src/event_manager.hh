@@ -41,17 +41,24 @@ public:
 
     int fd() const { return m_fd; }
     FdEvents events() const { return m_events; }
-    FdEvents& events() { return m_events; }
+    void set_events(FdEvents events);
 
     void run(FdEvents events, EventMode mode);
 
     void close_fd();
-    void disable() { m_fd = -1; }
+    void disable();
 
 private:
+    friend class EventManager;
+
     int      m_fd;
     FdEvents m_events;
     Callback m_callback;
+
+    size_t   m_index;              // position in EventManager::m_fd_watchers
+    int      m_polled_fd = -1;     // fd registered in the epoll set, if any
+    FdEvents m_polled_events = FdEvents::None;
+    bool     m_always_ready = false; // fd cannot be polled (regular file...)
 };
 
 class Timer
@@ -66,18 +73,56 @@ public:
     ~Timer();
 
     TimePoint next_date() const { return m_date; }
-    void      set_next_date(TimePoint date) { m_date = date; }
+    void      set_next_date(TimePoint date);
     void run(EventMode mode);
 
 private:
+    friend class EventManager;
+    static constexpr size_t not_scheduled = (size_t)-1;
+
     TimePoint m_date;
     EventMode m_mode;
     Callback  m_callback;
+    size_t    m_heap_index = not_scheduled;
+};
+
+// An IdleTask is run by the EventManager when no events are pending.
+// Once scheduled, its callback gets called repeatedly, each call doing
+// a unit of work, until it returns false, higher priority tasks first.
+class IdleTask
+{
+public:
+    using Callback = std::function<bool (IdleTask& task)>;
+
+    IdleTask(Callback callback, int priority = 0);
+    IdleTask(const IdleTask&) = delete;
+    IdleTask& operator=(const IdleTask&) = delete;
+    ~IdleTask();
+
+    int  priority() const { return m_priority; }
+    bool is_scheduled() const { return m_scheduled; }
+    void schedule();
+    void cancel();
+
+    bool run();
+
+private:
+    int      m_priority;
+    bool     m_scheduled = false;
+    Callback m_callback;
 };
 
 // The EventManager provides an interface to file descriptor
 // based event handling.
 //
+// On Linux, watched file descriptors are kept registered in an epoll
+// set, and only updated when a watcher changes, pselect is used as
+// the portable fallback. Timers are kept in a binary heap ordered
+// by next date.
+//
+// Idle tasks are only run in normal mode, when neither an fd nor
+// a timer fired, for at most idle_time_slice per call.
+//
 // The program main loop should call handle_next_events()
 // until it's time to quit.
 class EventManager : public Singleton<EventManager>
@@ -95,9 +140,32 @@ public:
 private:
     friend class FDWatcher;
     friend class Timer;
+    friend class IdleTask;
+
+    void add_watcher(FDWatcher& watcher);
+    void remove_watcher(FDWatcher& watcher);
+    void update_watcher(FDWatcher& watcher);
+    void unpoll_watcher(FDWatcher& watcher);
+
+    int  poll_select(EventMode mode, sigset_t* sigmask, const timespec* timeout);
+    int  poll_epoll(EventMode mode, sigset_t* sigmask, const timespec* timeout);
+    void reset_epoll();
+
+    void add_timer(Timer& timer);
+    void remove_timer(Timer& timer);
+    void update_timer(Timer& timer);
+    int  run_timers(EventMode mode);
+    void run_idle_tasks();
+
     Vector<FDWatcher*, MemoryDomain::Events> m_fd_watchers;
-    Vector<Timer*, MemoryDomain::Events>     m_timers;
+    Vector<Timer*, MemoryDomain::Events>     m_timers; // min heap on next_date
+    Vector<IdleTask*, MemoryDomain::Events>  m_idle_tasks; // scheduled, by priority
     fd_set m_forced_fd;
+    volatile sig_atomic_t m_has_forced_fd = 0;
+
+    int m_epoll_fd = -1;
+    Vector<FDWatcher*, MemoryDomain::Events> m_polled_watchers; // indexed by fd
+    Vector<FDWatcher*, MemoryDomain::Events> m_always_ready_watchers;
 
     TimePoint m_last;
 };
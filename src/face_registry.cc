@@ -3,6 +3,8 @@
 #include "exception.hh"
 #include "ranges.hh"
 #include "string_utils.hh"
+#include "unit_tests.hh"
+#include "utils.hh"
 
 namespace Kakoune
 {
@@ -71,6 +73,8 @@ String to_string(Face face)
     return format("{},{}{}", face.fg, face.bg, face.attributes);
 }
 
+size_t FaceRegistry::ms_generation = 0;
+
 Face FaceRegistry::operator[](const String& facedesc)
 {
     auto it = m_aliases.find(facedesc);
@@ -80,7 +84,17 @@ Face FaceRegistry::operator[](const String& facedesc)
             return it->value.face;
         it = m_aliases.find(it->value.alias);
     }
-    return parse_face(facedesc);
+
+    auto parsed_it = m_parsed_faces.find(facedesc);
+    if (parsed_it != m_parsed_faces.end())
+        return parsed_it->value;
+
+    Face face = parse_face(facedesc);
+    // descriptions can come from user strings, keep that bounded
+    if (m_parsed_faces.size() >= 1024)
+        m_parsed_faces.clear();
+    m_parsed_faces.insert({facedesc, face});
+    return face;
 }
 
 void FaceRegistry::register_alias(const String& name, const String& facedesc,
@@ -97,6 +111,7 @@ void FaceRegistry::register_alias(const String& name, const String& facedesc,
     if (name == facedesc)
         throw runtime_error(format("cannot alias face '{}' to itself", name));
 
+    ++ms_generation;
     FaceOrAlias& alias = m_aliases[name];
     auto it = m_aliases.find(facedesc);
     if (it != m_aliases.end())
@@ -126,6 +141,27 @@ CandidateList FaceRegistry::complete_alias_name(StringView prefix,
                     m_aliases | transform(std::mem_fn(&AliasMap::Item::key)));
 }
 
+const FaceHandle default_face{"Default"};
+const FaceHandle primary_selection_face{"PrimarySelection"};
+const FaceHandle secondary_selection_face{"SecondarySelection"};
+const FaceHandle primary_cursor_face{"PrimaryCursor"};
+const FaceHandle secondary_cursor_face{"SecondaryCursor"};
+const FaceHandle line_numbers_face{"LineNumbers"};
+const FaceHandle line_number_cursor_face{"LineNumberCursor"};
+const FaceHandle line_numbers_wrapped_face{"LineNumbersWrapped"};
+const FaceHandle menu_foreground_face{"MenuForeground"};
+const FaceHandle menu_background_face{"MenuBackground"};
+const FaceHandle information_face{"Information"};
+const FaceHandle error_face{"Error"};
+const FaceHandle status_line_face{"StatusLine"};
+const FaceHandle status_line_mode_face{"StatusLineMode"};
+const FaceHandle status_line_info_face{"StatusLineInfo"};
+const FaceHandle status_line_value_face{"StatusLineValue"};
+const FaceHandle status_cursor_face{"StatusCursor"};
+const FaceHandle matching_char_face{"MatchingChar"};
+const FaceHandle buffer_padding_face{"BufferPadding"};
+const FaceHandle whitespace_face{"Whitespace"};
+
 FaceRegistry::FaceRegistry()
     : m_aliases{
         { "Default", {Face{ Color::Default, Color::Default }} },
@@ -151,6 +187,23 @@ FaceRegistry::FaceRegistry()
         { "BufferPadding", {Face{ Color::Blue, Color::Default }} },
         { "Whitespace", {Face{ Color::Default, Color::Default }} },
       }
-{}
+{
+    ++ms_generation;
+}
+
+UnitTest test_face_handles{[]()
+{
+    auto& registry = FaceRegistry::instance();
+    const String error_desc = to_string(registry["Error"]);
+    auto restore = on_scope_end([&] { registry.register_alias("Error", error_desc, true); });
+
+    const FaceHandle literal{"red,blue+b"};
+    kak_assert(literal.get() == Face(Color::Red, Color::Blue, Attribute::Bold));
+
+    registry.register_alias("Error", "green", true);
+    kak_assert(error_face.get().fg == Color::Green);
+    registry.register_alias("Error", "blue", true);
+    kak_assert(error_face.get().fg == Color::Blue);
+}};
 
 }
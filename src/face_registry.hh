@@ -30,8 +30,15 @@ public:
     using AliasMap = HashMap<String, FaceOrAlias, MemoryDomain::Faces>;
     const AliasMap &aliases() const { return m_aliases; }
 
+    // changes whenever a face resolved through the registry might change
+    static size_t generation() { return ms_generation; }
+
 private:
     AliasMap m_aliases;
+    // parsed face descriptions, they do not depend on aliases
+    HashMap<String, Face, MemoryDomain::Faces> m_parsed_faces;
+
+    static size_t ms_generation;
 };
 
 inline Face get_face(const String& facedesc)
@@ -41,6 +48,61 @@ inline Face get_face(const String& facedesc)
     return Face{};
 }
 
+// Face description resolved on first use, and again only after the
+// registry changed, for faces that are looked up on every redraw.
+class FaceHandle
+{
+public:
+    FaceHandle(String facedesc = {}) : m_facedesc{std::move(facedesc)} {}
+
+    const String& facedesc() const { return m_facedesc; }
+    bool empty() const { return m_facedesc.empty(); }
+
+    friend bool operator==(const FaceHandle& lhs, const FaceHandle& rhs)
+    { return lhs.m_facedesc == rhs.m_facedesc; }
+    friend bool operator!=(const FaceHandle& lhs, const FaceHandle& rhs)
+    { return not (lhs == rhs); }
+
+    Face get() const
+    {
+        if (not FaceRegistry::has_instance())
+            return Face{};
+        if (m_generation != FaceRegistry::generation())
+        {
+            m_face = FaceRegistry::instance()[m_facedesc];
+            m_generation = FaceRegistry::generation();
+        }
+        return m_face;
+    }
+
+private:
+    String m_facedesc;
+    mutable Face m_face;
+    mutable size_t m_generation = 0;
+};
+
+// Handles to the default faces, for the ones used when drawing
+extern const FaceHandle default_face;
+extern const FaceHandle primary_selection_face;
+extern const FaceHandle secondary_selection_face;
+extern const FaceHandle primary_cursor_face;
+extern const FaceHandle secondary_cursor_face;
+extern const FaceHandle line_numbers_face;
+extern const FaceHandle line_number_cursor_face;
+extern const FaceHandle line_numbers_wrapped_face;
+extern const FaceHandle menu_foreground_face;
+extern const FaceHandle menu_background_face;
+extern const FaceHandle information_face;
+extern const FaceHandle error_face;
+extern const FaceHandle status_line_face;
+extern const FaceHandle status_line_mode_face;
+extern const FaceHandle status_line_info_face;
+extern const FaceHandle status_line_value_face;
+extern const FaceHandle status_cursor_face;
+extern const FaceHandle matching_char_face;
+extern const FaceHandle buffer_padding_face;
+extern const FaceHandle whitespace_face;
+
 String to_string(Face face);
 
 }
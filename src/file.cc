@@ -2,6 +2,7 @@
 
 #include "assert.hh"
 #include "buffer.hh"
+#include "directory_cache.hh"
 #include "exception.hh"
 #include "flags.hh"
 #include "ranked_match.hh"
@@ -16,7 +17,7 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <cstdlib>
-#include <sys/select.h>
+#include <poll.h>
 
 #if defined(__FreeBSD__)
 #include <sys/sysctl.h>
@@ -125,24 +126,21 @@ StringView tmpdir()
     return "/tmp";
 }
 
-bool fd_readable(int fd)
+// poll is used rather than select, which cannot handle fds above FD_SETSIZE
+static bool fd_ready(int fd, short events)
 {
-    fd_set  rfds;
-    FD_ZERO(&rfds);
-    FD_SET(fd, &rfds);
+    pollfd pfd{fd, events, 0};
+    return poll(&pfd, 1, 0) == 1 and (pfd.revents & (events | POLLHUP | POLLERR));
+}
 
-    timeval tv{0,0};
-    return select(fd+1, &rfds, nullptr, nullptr, &tv) == 1;
+bool fd_readable(int fd)
+{
+    return fd_ready(fd, POLLIN);
 }
 
 bool fd_writable(int fd)
 {
-    fd_set  wfds;
-    FD_ZERO(&wfds);
-    FD_SET(fd, &wfds);
-
-    timeval tv{0,0};
-    return select(fd+1, nullptr, &wfds, nullptr, &tv) == 1;
+    return fd_ready(fd, POLLOUT);
 }
 
 String read_fd(int fd, bool text)
@@ -421,20 +419,28 @@ CandidateList complete_filename(StringView prefix, const Regex& ignored_regex,
         not regex_match(fileprefix.begin(), fileprefix.end(), ignored_regex);
     const bool only_dirs = (flags & FilenameFlags::OnlyDirectories);
 
-    auto filter = [&ignored_regex, check_ignored_regex, only_dirs](const dirent& entry, struct stat& st)
+    auto filter = [&ignored_regex, check_ignored_regex, only_dirs](const DirectoryEntry& entry)
     {
-        StringView name{entry.d_name};
+        StringView name = entry.filename();
         return (not check_ignored_regex or not regex_match(name.begin(), name.end(), ignored_regex)) and
-               (not only_dirs or S_ISDIR(st.st_mode));
+               (not only_dirs or entry.is_directory());
     };
-    auto files = list_files(parsed_dirname, filter);
-    Vector<RankedMatch> matches;
-    for (auto& file : files)
+
+    DirectoryEntries uncached_entries;
+    ConstArrayView<DirectoryEntry> entries;
+    if (DirectoryCache::has_instance())
+        entries = DirectoryCache::instance().entries(parsed_dirname);
+    else
+        entries = uncached_entries = read_directory(parsed_dirname);
+
+    Vector<StringView> files;
+    for (auto& entry : entries)
     {
-        if (RankedMatch match{file, fileprefix})
-            matches.push_back(match);
+        if (filter(entry))
+            files.push_back(entry.name);
     }
-    std::sort(matches.begin(), matches.end());
+    auto matches = ranked_matches(files, fileprefix);
+    keep_best_matches(matches);
     const bool expand = (flags & FilenameFlags::Expand);
     return candidates(matches, expand ? parsed_dirname : dirname);
 }
@@ -455,13 +461,8 @@ CandidateList complete_command(StringView prefix, ByteCount cursor_pos)
             return S_ISDIR(st.st_mode) or (S_ISREG(st.st_mode) and executable);
         };
         auto files = list_files(dirname, filter);
-        Vector<RankedMatch> matches;
-        for (auto& file : files)
-        {
-            if (RankedMatch match{file, real_prefix})
-                matches.push_back(match);
-        }
-        std::sort(matches.begin(), matches.end());
+        auto matches = ranked_matches(Vector<StringView>{files.begin(), files.end()}, real_prefix);
+        keep_best_matches(matches);
         return candidates(matches, dirname);
     }
 
@@ -496,13 +497,11 @@ CandidateList complete_command(StringView prefix, ByteCount cursor_pos)
             cache.commands = list_files(dirname, filter);
             memcpy(&cache.mtim, &st.st_mtim, sizeof(TimeSpec));
         }
-        for (auto& cmd : cache.commands)
-        {
-            if (RankedMatch match{cmd, fileprefix})
-                matches.push_back(match);
-        }
+        auto dir_matches = ranked_matches(Vector<StringView>{cache.commands.begin(), cache.commands.end()},
+                                          fileprefix);
+        matches.insert(matches.end(), dir_matches.begin(), dir_matches.end());
     }
-    std::sort(matches.begin(), matches.end());
+    keep_best_matches(matches);
     auto it = std::unique(matches.begin(), matches.end());
     matches.erase(it, matches.end());
     return candidates(matches, "");
@@ -0,0 +1,421 @@
+#include "file_index.hh"
+
+#include "directory_cache.hh"
+#include "file.hh"
+#include "file_watcher.hh"
+#include "string_utils.hh"
+
+#include <cstring>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace Kakoune
+{
+
+static bool is_ignored(const Regex& ignored_regex, const char* name, size_t len)
+{
+    if (ignored_regex.empty())
+        return false;
+    // Called from walker threads, so matching errors must not be rethrown
+    // as Kakoune exceptions, whose message is a Kakoune String
+    const char* end = name + len;
+    try
+    {
+        return boost::regex_match<RegexUtf8It<const char*>>({name, name, end}, {end, name, end},
+                                                            ignored_regex);
+    }
+    catch (std::runtime_error&)
+    {
+        return false;
+    }
+}
+
+ProjectFileIndex::ProjectFileIndex()
+{
+    if (pipe(m_notify_pipe) == 0)
+    {
+        for (auto fd : m_notify_pipe)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        m_notify_watcher.reset(new FDWatcher{m_notify_pipe[0], FdEvents::Read,
+                                             [this](FDWatcher& watcher, FdEvents, EventMode) {
+            char buffer[256];
+            while (read(watcher.fd(), buffer, sizeof(buffer)) > 0)
+                ;
+            merge_walk_results();
+        }});
+    }
+}
+
+ProjectFileIndex::~ProjectFileIndex()
+{
+    stop_walk();
+    remove_watches();
+    m_notify_watcher.reset();
+    for (auto fd : m_notify_pipe)
+    {
+        if (fd != -1)
+            close(fd);
+    }
+}
+
+bool ProjectFileIndex::is_walking() const
+{
+    std::lock_guard<std::mutex> lock{m_walk_mutex};
+    return m_running_walkers > 0;
+}
+
+void ProjectFileIndex::finish_walk()
+{
+    std::unique_lock<std::mutex> lock{m_walk_mutex};
+    while (m_running_walkers > 0)
+    {
+        // found directories need to be watched from this thread
+        m_walk_cond.wait(lock, [this] {
+            return m_running_walkers == 0 or not m_found_dirs.empty();
+        });
+        lock.unlock();
+        merge_walk_results();
+        lock.lock();
+    }
+    lock.unlock();
+    merge_walk_results();
+}
+
+void ProjectFileIndex::reset(String root, const Regex& ignored_regex)
+{
+    stop_walk();
+    remove_watches();
+    m_files.clear();
+
+    m_root = std::move(root);
+    m_ignored_regex = ignored_regex;
+    m_stale = false;
+    walk({String{}});
+}
+
+void ProjectFileIndex::stop_walk()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_walk_mutex};
+        m_stop_walk = true;
+    }
+    m_walk_cond.notify_all();
+    for (auto& walker : m_walkers)
+        walker.join();
+    m_walkers.clear();
+
+    std::lock_guard<std::mutex> lock{m_walk_mutex};
+    m_stop_walk = false;
+    m_pending_dirs.clear();
+    m_found_files.clear();
+    m_found_dirs.clear();
+}
+
+void ProjectFileIndex::walk(Vector<String> directories)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_walk_mutex};
+        for (auto& directory : directories)
+        {
+            add_watch(directory);
+            m_pending_dirs.emplace_back(directory.begin(), directory.end());
+        }
+        if (m_running_walkers > 0)
+        {
+            m_walk_cond.notify_all();
+            return;
+        }
+    }
+
+    // Previous walkers are done, they only need to be joined
+    for (auto& walker : m_walkers)
+        walker.join();
+    m_walkers.clear();
+
+    // Directory walking is mostly waiting for the file system, use more
+    // threads than cores. Signals are left to the main thread.
+    const unsigned walker_count = clamp(std::thread::hardware_concurrency(), 2u, 8u);
+    sigset_t mask, orig_mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &orig_mask);
+    for (unsigned i = 0; i < walker_count; ++i)
+    {
+        try
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_walk_mutex};
+                ++m_running_walkers;
+            }
+            m_walkers.emplace_back([this] { walk_directories(); });
+        }
+        catch (std::system_error&)
+        {
+            std::lock_guard<std::mutex> lock{m_walk_mutex};
+            --m_running_walkers;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &orig_mask, nullptr);
+
+    if (m_walkers.empty())
+    {
+        // walk from this thread, watching the found directories between passes
+        std::unique_lock<std::mutex> lock{m_walk_mutex};
+        m_walk_inline = true;
+        while (not m_pending_dirs.empty())
+        {
+            ++m_running_walkers;
+            lock.unlock();
+            walk_directories();
+            merge_walk_results();
+            lock.lock();
+        }
+        m_walk_inline = false;
+    }
+}
+
+// Runs in the walker threads, which must not use Kakoune containers as
+// memory domain accounting is not thread safe.
+void ProjectFileIndex::walk_directories()
+{
+    const char* root = m_root.c_str();
+    const Regex& ignored_regex = m_ignored_regex;
+
+    std::unique_lock<std::mutex> lock{m_walk_mutex};
+    while (true)
+    {
+        // found directories are walked once the main thread watched them
+        m_walk_cond.wait(lock, [this] {
+            return m_stop_walk or not m_pending_dirs.empty() or
+                   (m_busy_walkers == 0 and (m_found_dirs.empty() or m_walk_inline));
+        });
+        if (m_stop_walk or m_pending_dirs.empty())
+            break;
+
+        std::string directory = std::move(m_pending_dirs.front());
+        m_pending_dirs.pop_front();
+        ++m_busy_walkers;
+        lock.unlock();
+
+        const std::string path = root + directory;
+        std::vector<std::string> files;
+        std::vector<std::string> subdirs;
+
+        if (DIR* dir = opendir(path.c_str()))
+        {
+            while (dirent* entry = readdir(dir))
+            {
+                const char* name = entry->d_name;
+                const size_t len = ::strlen(name);
+                if ((len == 1 and name[0] == '.') or (len == 2 and name[0] == '.' and name[1] == '.'))
+                    continue;
+                if (is_ignored(ignored_regex, name, len))
+                    continue;
+
+                // symbolic links to directories are not followed, to avoid cycles
+                const auto type = directory_entry_type({path.c_str(), (int)path.size()}, *entry, false);
+                if (type == DirectoryEntryType::Skipped)
+                    continue;
+
+                if (type == DirectoryEntryType::Directory)
+                    subdirs.push_back(directory + name + '/');
+                else
+                    files.push_back(directory + name);
+            }
+            closedir(dir);
+        }
+
+        lock.lock();
+        --m_busy_walkers;
+        for (auto& file : files)
+            m_found_files.push_back(std::move(file));
+        for (auto& subdir : subdirs)
+            m_found_dirs.push_back(std::move(subdir));
+        m_walk_cond.notify_all();
+        if (m_notify_pipe[1] != -1)
+            ::write(m_notify_pipe[1], "", 1);
+    }
+
+    --m_running_walkers;
+    m_walk_cond.notify_all();
+    if (m_notify_pipe[1] != -1)
+        ::write(m_notify_pipe[1], "", 1);
+}
+
+void ProjectFileIndex::merge_walk_results()
+{
+    std::vector<std::string> files;
+    bool found_dirs, done;
+    {
+        std::lock_guard<std::mutex> lock{m_walk_mutex};
+        files.swap(m_found_files);
+        found_dirs = not m_found_dirs.empty();
+        for (auto& directory : m_found_dirs)
+        {
+            add_watch(String{directory.data(), (int)directory.size()});
+            m_pending_dirs.push_back(std::move(directory));
+        }
+        m_found_dirs.clear();
+        done = m_running_walkers == 0;
+    }
+    if (found_dirs)
+        m_walk_cond.notify_all();
+
+    for (auto& file : files)
+    {
+        StringView path{file.data(), (int)file.size()};
+        if (not m_files.contains(path))
+            m_files.insert({path.str(), used_letters(path)});
+    }
+
+    if (done)
+    {
+        for (auto& walker : m_walkers)
+            walker.join();
+        m_walkers.clear();
+    }
+}
+
+void ProjectFileIndex::add_watch(const String& directory)
+{
+#if defined(__linux__)
+    if (not FileWatcher::has_instance())
+        return;
+
+    auto& file_watcher = FileWatcher::instance();
+    auto it = m_directories.find(directory);
+    if (it != m_directories.end())
+    {
+        file_watcher.unwatch_directory(it->value);
+        m_directories.unordered_remove(directory);
+    }
+
+    const int watch = file_watcher.watch_directory(
+        m_root + directory, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO,
+        [this, directory](int mask, StringView name) { on_event(directory, mask, name); });
+    if (watch != -1)
+        m_directories.insert({directory, watch});
+#endif
+}
+
+void ProjectFileIndex::remove_watches()
+{
+    if (FileWatcher::has_instance())
+    {
+        for (auto& directory : m_directories)
+            FileWatcher::instance().unwatch_directory(directory.value);
+    }
+    m_directories.clear();
+}
+
+void ProjectFileIndex::on_event(StringView directory, int mask, StringView name)
+{
+#if defined(__linux__)
+    if (mask & IN_Q_OVERFLOW)
+    {
+        // events were lost, the index cannot be trusted anymore
+        m_stale = true;
+        return;
+    }
+    if (name.empty() or is_ignored(m_ignored_regex, name.begin(), (size_t)(int)name.length()))
+        return;
+
+    // know about every walked file before looking at their events
+    merge_walk_results();
+
+    String path = directory + name;
+    if (mask & (IN_CREATE | IN_MOVED_TO))
+    {
+        if (mask & IN_ISDIR)
+            walk({path + "/"});
+        else
+        {
+            struct stat st;
+            if (stat(format("{}{}", m_root, path).c_str(), &st) != 0 or S_ISDIR(st.st_mode))
+                return;
+            if (not m_files.contains(path))
+                m_files.insert({path, used_letters(path)});
+        }
+    }
+    else if (mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+        if (mask & IN_ISDIR)
+            remove_directory(path + "/");
+        else
+            m_files.unordered_remove(path);
+    }
+#endif
+}
+
+void ProjectFileIndex::remove_directory(StringView directory)
+{
+    Vector<String, MemoryDomain::Completion> files;
+    for (auto& file : m_files)
+    {
+        if (prefix_match(file.key, directory))
+            files.push_back(file.key);
+    }
+    for (auto& file : files)
+        m_files.unordered_remove(file);
+
+    // moved away directories are still watched
+    Vector<String, MemoryDomain::Completion> directories;
+    for (auto& dir : m_directories)
+    {
+        if (prefix_match(dir.key, directory))
+            directories.push_back(dir.key);
+    }
+    for (auto& dir : directories)
+    {
+        if (FileWatcher::has_instance())
+            FileWatcher::instance().unwatch_directory(m_directories[dir]);
+        m_directories.unordered_remove(dir);
+    }
+}
+
+CandidateList ProjectFileIndex::complete(StringView query, const Regex& ignored_regex)
+{
+    char cwd[PATH_MAX+1];
+    if (not getcwd(cwd, sizeof(cwd)))
+        return {};
+    String root = cwd;
+    if (root.back() != '/')
+        root += '/';
+
+    if (FileWatcher::has_instance())
+        FileWatcher::instance().read_events();
+
+    if (root != m_root or ignored_regex != m_ignored_regex or m_stale)
+        reset(std::move(root), ignored_regex);
+    else
+        merge_walk_results();
+
+    const UsedLetters query_letters = used_letters(query);
+    Vector<RankedMatch> matches;
+    for (auto& file : m_files)
+    {
+        if (RankedMatch match{file.key, file.value, query, query_letters})
+            matches.push_back(match);
+    }
+    keep_best_matches(matches);
+
+    CandidateList res;
+    res.reserve(matches.size());
+    for (auto& match : matches)
+        res.push_back(match.candidate().str());
+    return res;
+}
+
+}
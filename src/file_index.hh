@@ -0,0 +1,103 @@
+#ifndef file_index_hh_INCLUDED
+#define file_index_hh_INCLUDED
+
+#include "completion.hh"
+#include "enum.hh"
+#include "event_manager.hh"
+#include "hash_map.hh"
+#include "ranked_match.hh"
+#include "regex.hh"
+#include "string.hh"
+#include "utils.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Kakoune
+{
+
+enum class EditCompletion
+{
+    Directory,
+    Project
+};
+
+constexpr auto enum_desc(Meta::Type<EditCompletion>)
+{
+    return make_array<EnumDesc<EditCompletion>, 2>({
+        { EditCompletion::Directory, "directory" },
+        { EditCompletion::Project, "project" },
+    });
+}
+
+// Index of the files under the current working directory, so that any of
+// them can be completed by fuzzy matching its whole path.
+//
+// The tree is walked by background threads on first use, skipping the files
+// and directories whose name matches the ignore regex. On Linux, indexed
+// directories are watched through the FileWatcher, and the index follows the
+// files being created, deleted or renamed.
+class ProjectFileIndex : public Singleton<ProjectFileIndex>
+{
+public:
+    ProjectFileIndex();
+    ~ProjectFileIndex();
+
+    // Returns the indexed paths best matching query, relative to the
+    // current directory. The index is (re)built when the current directory
+    // or ignored_regex changed, results are partial until the walk is done.
+    CandidateList complete(StringView query, const Regex& ignored_regex);
+
+    size_t file_count() const { return m_files.size(); }
+    size_t watched_directory_count() const { return m_directories.size(); }
+    bool is_walking() const;
+    // Waits for the walk in progress to complete
+    void finish_walk();
+
+private:
+    void reset(String root, const Regex& ignored_regex);
+    void stop_walk();
+    void walk(Vector<String> directories);
+    void walk_directories();
+    void merge_walk_results();
+    void add_watch(const String& directory);
+    void remove_watches();
+    void on_event(StringView directory, int mask, StringView name);
+    void remove_directory(StringView directory);
+
+    String m_root; // absolute path, with a trailing '/'
+    Regex m_ignored_regex;
+    bool m_stale = false; // watch events were lost
+
+    // indexed file paths, relative to m_root, with their used letters
+    HashMap<String, UsedLetters, MemoryDomain::Completion> m_files;
+    // FileWatcher watches of indexed directories, relative to m_root
+    HashMap<String, int, MemoryDomain::Completion> m_directories;
+
+    // Walker threads only use the standard library containers below, under
+    // m_walk_mutex, and notify the main thread through m_notify_pipe. The
+    // directories they find are watched by the main thread before being
+    // queued for walking.
+    mutable std::mutex m_walk_mutex;
+    std::condition_variable m_walk_cond;
+    std::deque<std::string> m_pending_dirs;
+    std::vector<std::string> m_found_files;
+    std::vector<std::string> m_found_dirs;
+    int m_busy_walkers = 0;
+    int m_running_walkers = 0;
+    bool m_stop_walk = false;
+    bool m_walk_inline = false;
+    std::vector<std::thread> m_walkers;
+
+    int m_notify_pipe[2] = {-1, -1};
+    std::unique_ptr<FDWatcher> m_notify_watcher;
+};
+
+}
+
+#endif // file_index_hh_INCLUDED
@@ -0,0 +1,297 @@
+#include "file_watcher.hh"
+
+#include "buffer.hh"
+#include "buffer_utils.hh"
+#include "client.hh"
+#include "client_manager.hh"
+#include "file.hh"
+#include "input_handler.hh"
+#include "ranges.hh"
+#include "string_utils.hh"
+
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace Kakoune
+{
+
+// bursts of events, such as a file being written in several chunks or a
+// version control checkout, are handled together after that delay
+constexpr auto coalesce_delay = std::chrono::milliseconds{50};
+
+FileWatcher::FileWatcher()
+    : m_notify_timer{TimePoint::max(), [this](Timer&) { notify_modified(); }}
+{
+#if defined(__linux__)
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify_fd != -1)
+        m_watcher.reset(new FDWatcher{m_inotify_fd, FdEvents::Read,
+                                      [this](FDWatcher&, FdEvents, EventMode) { read_events(); }});
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+    m_watcher.reset();
+    if (m_inotify_fd != -1)
+        close(m_inotify_fd);
+}
+
+int FileWatcher::watch_directory(StringView directory, int mask, WatchCallback callback)
+{
+#if defined(__linux__)
+    if (m_inotify_fd == -1)
+        return -1;
+
+    // IN_MASK_ADD keeps the events other watchers of that directory need
+    const int wd = inotify_add_watch(m_inotify_fd, directory.zstr(),
+                                     mask | IN_MASK_ADD | IN_ONLYDIR);
+    if (wd == -1)
+        return -1;
+
+    const int watch = m_next_watch++;
+    m_watches.insert({watch, {wd, std::move(callback)}});
+    m_watches_by_wd[wd].push_back(watch);
+    return watch;
+#else
+    return -1;
+#endif
+}
+
+void FileWatcher::unwatch_directory(int watch)
+{
+    auto it = m_watches.find(watch);
+    if (it == m_watches.end())
+        return;
+
+    const int wd = it->value.wd;
+    m_watches.unordered_remove(watch);
+
+    auto& watches = m_watches_by_wd[wd];
+    unordered_erase(watches, watch);
+    if (not watches.empty())
+        return;
+
+    m_watches_by_wd.unordered_remove(wd);
+#if defined(__linux__)
+    inotify_rm_watch(m_inotify_fd, wd);
+#endif
+}
+
+void FileWatcher::read_events()
+{
+#if defined(__linux__)
+    if (m_inotify_fd == -1)
+        return;
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t len;
+    while ((len = read(m_inotify_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* ptr = buffer; ptr < buffer + len; )
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            // callbacks can add and remove watches, only keep their ids
+            Vector<int, MemoryDomain::Events> watches;
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                for (auto& watch : m_watches)
+                    watches.push_back(watch.key);
+            }
+            else
+            {
+                auto it = m_watches_by_wd.find(event->wd);
+                if (it == m_watches_by_wd.end())
+                    continue;
+                watches = it->value;
+                if (event->mask & IN_IGNORED)
+                    m_watches_by_wd.unordered_remove(event->wd);
+            }
+
+            StringView name = event->len != 0 ? StringView{event->name} : StringView{};
+            for (auto watch : watches)
+            {
+                auto it = m_watches.find(watch);
+                if (it == m_watches.end())
+                    continue;
+
+                WatchCallback callback = it->value.callback;
+                if (event->mask & IN_IGNORED)
+                    m_watches.unordered_remove(watch);
+                callback(event->mask, name);
+            }
+        }
+    }
+#endif
+}
+
+void FileWatcher::watch(const Buffer& buffer)
+{
+    kak_assert(buffer.flags() & Buffer::Flags::File);
+    unwatch(buffer);
+
+    StringView directory, filename;
+    std::tie(directory, filename) = split_path(buffer.name());
+    m_files.insert({&buffer, {directory.str(), filename.str(), false}});
+
+    auto& watched = m_directories[directory.str()];
+    watched.files[filename.str()] = &buffer;
+    if (watched.watch == -1)
+        watch_buffer_directory(directory, watched);
+}
+
+void FileWatcher::unwatch(const Buffer& buffer)
+{
+    auto it = m_files.find(&buffer);
+    if (it == m_files.end())
+        return;
+
+    auto dir = m_directories.find(it->value.directory);
+    kak_assert(dir != m_directories.end());
+    dir->value.files.unordered_remove(it->value.filename);
+    if (dir->value.files.empty())
+    {
+        unwatch_directory(dir->value.watch);
+        m_directories.unordered_remove(it->value.directory);
+    }
+    m_files.unordered_remove(&buffer);
+}
+
+bool FileWatcher::check_modified(const Buffer& buffer)
+{
+    auto it = m_files.find(&buffer);
+    if (it == m_files.end())
+        return true;
+
+    auto& watched = m_directories[it->value.directory];
+    if (watched.watch == -1)
+    {
+        // the directory might have been created since
+        watch_buffer_directory(it->value.directory, watched);
+        return true;
+    }
+    return it->value.modified;
+}
+
+void FileWatcher::clear_modified(const Buffer& buffer)
+{
+    auto it = m_files.find(&buffer);
+    if (it != m_files.end())
+        it->value.modified = false;
+}
+
+void FileWatcher::watch_buffer_directory(StringView directory, WatchedDirectory& watched)
+{
+#if defined(__linux__)
+    watched.watch = watch_directory(directory,
+                                    IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                                    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                    IN_DELETE_SELF | IN_MOVE_SELF,
+                                    [this, directory = directory.str()](int mask, StringView name) {
+                                        on_buffer_directory_event(directory, mask, name);
+                                    });
+#endif
+}
+
+void FileWatcher::on_buffer_directory_event(StringView directory, int mask, StringView name)
+{
+#if defined(__linux__)
+    auto it = m_directories.find(directory);
+    if (it == m_directories.end())
+        return;
+
+    auto& watched = it->value;
+    const bool directory_gone = mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED);
+    bool received = false;
+    if (directory_gone or mask & IN_Q_OVERFLOW)
+    {
+        for (auto& file : watched.files)
+            m_files[file.value].modified = true;
+        received = true;
+    }
+    else
+    {
+        auto file = watched.files.find(name);
+        if (file != watched.files.end())
+        {
+            m_files[file->value].modified = true;
+            received = true;
+        }
+    }
+
+    if (directory_gone)
+    {
+        // fall back to checking the file timestamps
+        unwatch_directory(watched.watch);
+        watched.watch = -1;
+    }
+
+    if (received and m_notify_timer.next_date() == TimePoint::max())
+        m_notify_timer.set_next_date(Clock::now() + coalesce_delay);
+#endif
+}
+
+void FileWatcher::notify_modified()
+{
+    if (not ClientManager::has_instance())
+        return;
+
+    Vector<const Buffer*> buffers;
+    for (auto& file : m_files)
+    {
+        if (file.value.modified)
+            buffers.push_back(file.key);
+    }
+
+    for (auto* watched : buffers)
+    {
+        // reloading a buffer runs hooks, which could have closed this one
+        if (not m_files.contains(watched))
+            continue;
+
+        Buffer& buffer = const_cast<Buffer&>(*watched);
+        bool displayed = false;
+        for (auto& client : ClientManager::instance())
+        {
+            if (&client->context().buffer() != &buffer)
+                continue;
+            displayed = true;
+            if (client->context().input_handler().in_normal_mode())
+                client->check_if_buffer_needs_reloading();
+        }
+
+        // clients will check their buffer when back in normal mode,
+        // hidden buffers are only reloaded if that needs no confirmation
+        if (displayed or buffer.options()["autoreload"].get<Autoreload>() != Autoreload::Yes)
+            continue;
+
+        auto file = m_files.find(watched);
+        if (file == m_files.end() or not file->value.modified)
+            continue;
+
+        timespec ts = get_fs_timestamp(buffer.name());
+        if (ts == InvalidTime)
+            continue;
+        if (ts == buffer.fs_timestamp())
+        {
+            file->value.modified = false;
+            continue;
+        }
+        try
+        {
+            reload_file_buffer(buffer);
+        }
+        catch (runtime_error& error)
+        {
+            write_to_debug_buffer(format("error while reloading buffer '{}': {}",
+                                         buffer.display_name(), error.what()));
+        }
+    }
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef file_watcher_hh_INCLUDED
+#define file_watcher_hh_INCLUDED
+
+#include "event_manager.hh"
+#include "hash_map.hh"
+#include "string.hh"
+#include "utils.hh"
+
+#include <functional>
+#include <memory>
+
+namespace Kakoune
+{
+
+class Buffer;
+
+// Shared inotify watch service, and watcher of the files of file buffers.
+//
+// On Linux, a single inotify instance is read from the event loop, and its
+// events are dispatched to the callbacks registered for the watched
+// directory. Other platforms cannot watch directories, users are expected
+// to fall back to checking timestamps.
+//
+// The directory containing each buffer file is watched this way, so that
+// checking if a buffer needs reloading does not need to stat its file unless
+// an event was received for it. Events are gathered for a short delay before
+// the clients displaying the modified buffers are asked to check them, and
+// hidden buffers set to autoreload are reloaded.
+class FileWatcher : public Singleton<FileWatcher>
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // Called with the inotify mask of an event and the name of the entry
+    // it concerns, if any. IN_Q_OVERFLOW is given to every callback when
+    // events were lost, and IN_IGNORED once the directory is not watched
+    // anymore, in which case the watch is already removed.
+    using WatchCallback = std::function<void (int mask, StringView name)>;
+
+    // Watches directory for the given inotify events. As watches of the
+    // same directory are shared, callbacks can receive events from other
+    // watchers masks. Returns an id for unwatch_directory, or -1 if the
+    // directory cannot be watched.
+    int watch_directory(StringView directory, int mask, WatchCallback callback);
+    void unwatch_directory(int watch);
+
+    // Dispatches the pending events without waiting for the event loop
+    void read_events();
+
+    void watch(const Buffer& buffer);
+    void unwatch(const Buffer& buffer);
+
+    // Returns true if the buffer file may have been modified since it was
+    // last known to match the buffer, which is always the case if it cannot
+    // be watched. Every client displaying the buffer needs to check it, so
+    // that stays true until clear_modified is called.
+    bool check_modified(const Buffer& buffer);
+    // Called once the buffer timestamp matches its file again
+    void clear_modified(const Buffer& buffer);
+
+private:
+    struct Watch
+    {
+        int wd;
+        WatchCallback callback;
+    };
+
+    struct WatchedFile
+    {
+        String directory;
+        String filename;
+        bool modified;
+    };
+
+    struct WatchedDirectory
+    {
+        int watch = -1;
+        HashMap<String, const Buffer*, MemoryDomain::BufferMeta> files; // by filename
+    };
+
+    void watch_buffer_directory(StringView directory, WatchedDirectory& watched);
+    void on_buffer_directory_event(StringView directory, int mask, StringView name);
+    void notify_modified();
+
+    int m_inotify_fd = -1;
+    std::unique_ptr<FDWatcher> m_watcher;
+    int m_next_watch = 0;
+    HashMap<int, Watch, MemoryDomain::Events> m_watches;
+    HashMap<int, Vector<int, MemoryDomain::Events>, MemoryDomain::Events> m_watches_by_wd;
+
+    Timer m_notify_timer;
+    HashMap<const Buffer*, WatchedFile, MemoryDomain::BufferMeta> m_files;
+    HashMap<String, WatchedDirectory, MemoryDomain::BufferMeta> m_directories;
+};
+
+}
+
+#endif // file_watcher_hh_INCLUDED
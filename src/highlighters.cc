@@ -228,11 +228,11 @@ static HighlighterAndId create_fill_highlighter(HighlighterParameters params)
     const String& facespec = params[0];
     get_face(facespec); // validate param
 
-    auto func = [=](const Context& context, HighlightPass pass,
-                    DisplayBuffer& display_buffer, BufferRange range)
+    auto func = [face = FaceHandle{facespec}](const Context& context, HighlightPass pass,
+                                              DisplayBuffer& display_buffer, BufferRange range)
     {
         highlight_range(display_buffer, range.begin, range.end, true,
-                        apply_face(get_face(facespec)));
+                        apply_face(face.get()));
     };
     return {"fill_" + facespec, make_highlighter(std::move(func))};
 }
@@ -253,7 +253,7 @@ private:
     ValueId m_id;
 };
 
-using FacesSpec = Vector<std::pair<size_t, String>, MemoryDomain::Highlight>;
+using FacesSpec = Vector<std::pair<size_t, FaceHandle>, MemoryDomain::Highlight>;
 
 class RegexHighlighter : public Highlighter
 {
@@ -280,7 +280,7 @@ public:
         for (int f = 0; f < m_faces.size(); ++f)
         {
             if (not m_faces[f].second.empty())
-                faces[f] = get_face(m_faces[f].second);
+                faces[f] = m_faces[f].second.get();
         }
 
         auto& matches = get_matches(context.buffer(), display_buffer.range(), range);
@@ -352,11 +352,11 @@ private:
             return;
 
         std::sort(m_faces.begin(), m_faces.end(),
-                  [](const std::pair<size_t, String>& lhs,
-                     const std::pair<size_t, String>& rhs)
+                  [](const std::pair<size_t, FaceHandle>& lhs,
+                     const std::pair<size_t, FaceHandle>& rhs)
                   { return lhs.first < rhs.first; });
         if (m_faces[0].first != 0)
-            m_faces.emplace(m_faces.begin(), 0, String{});
+            m_faces.emplace(m_faces.begin(), 0, FaceHandle{});
     }
 
     void add_matches(const Buffer& buffer, MatchList& matches,
@@ -547,6 +547,7 @@ HighlighterAndId create_line_highlighter(HighlighterParameters params)
     String line_expr = params[0];
 
     get_face(facespec); // validate facespec
+    FaceHandle facehandle{facespec};
 
     auto func = [=](const Context& context, HighlightPass, DisplayBuffer& display_buffer, BufferRange)
     {
@@ -570,7 +571,7 @@ HighlighterAndId create_line_highlighter(HighlighterParameters params)
         if (it == display_buffer.lines().end())
             return;
 
-        auto face = get_face(facespec);
+        auto face = facehandle.get();
         ColumnCount column = 0;
         for (auto& atom : *it)
         {
@@ -598,6 +599,7 @@ HighlighterAndId create_column_highlighter(HighlighterParameters params)
     String col_expr = params[0];
 
     get_face(facespec); // validate facespec
+    FaceHandle facehandle{facespec};
 
     auto func = [=](const Context& context, HighlightPass, DisplayBuffer& display_buffer, BufferRange)
     {
@@ -615,7 +617,7 @@ HighlighterAndId create_column_highlighter(HighlighterParameters params)
         if (column < 0)
             return;
 
-        auto face = get_face(facespec);
+        auto face = facehandle.get();
         auto win_column = context.window().position().column;
         for (auto& line : display_buffer.lines())
         {
@@ -666,7 +668,7 @@ struct WrapHighlighter : Highlighter
 
         const Buffer& buffer = context.buffer();
         const auto& cursor = context.selections().main().cursor();
-        const int tabstop = context.options()["tabstop"].get<int>();
+        const int tabstop = context.options().get(tabstop_option);
         const LineCount win_height = context.window().dimensions().line;
         for (auto it = display_buffer.lines().begin();
              it != display_buffer.lines().end(); ++it)
@@ -725,7 +727,7 @@ struct WrapHighlighter : Highlighter
 
         const Buffer& buffer = context.buffer();
         const auto& cursor = context.selections().main().cursor();
-        const int tabstop = context.options()["tabstop"].get<int>();
+        const int tabstop = context.options().get(tabstop_option);
 
         auto line_wrap_count = [&](LineCount line) {
             LineCount count = 0;
@@ -850,7 +852,7 @@ struct TabulationHighlighter : Highlighter
     void do_highlight(const Context& context, HighlightPass,
                       DisplayBuffer& display_buffer, BufferRange) override
     {
-        const ColumnCount tabstop = context.options()["tabstop"].get<int>();
+        const ColumnCount tabstop = context.options().get(tabstop_option);
         auto& buffer = context.buffer();
         auto win_column = context.window().position().column;
         for (auto& line : display_buffer.lines())
@@ -890,7 +892,7 @@ struct TabulationHighlighter : Highlighter
         if (buffer.byte_at(cursor) != '\t')
             return;
 
-        const ColumnCount tabstop = context.options()["tabstop"].get<int>();
+        const ColumnCount tabstop = context.options().get(tabstop_option);
         const ColumnCount column = get_column(buffer, tabstop, cursor);
         const ColumnCount width = tabstop - (column % tabstop);
         const ColumnCount win_end = setup.window_pos.column + setup.window_range.column;
@@ -905,8 +907,8 @@ void show_whitespaces(const Context& context, HighlightPass, DisplayBuffer& disp
                       StringView tab, StringView tabpad,
                       StringView spc, StringView lf, StringView nbsp)
 {
-    const int tabstop = context.options()["tabstop"].get<int>();
-    auto whitespaceface = get_face("Whitespace");
+    const int tabstop = context.options().get(tabstop_option);
+    auto whitespaceface = whitespace_face.get();
     auto& buffer = context.buffer();
     auto win_column = context.window().position().column;
     for (auto& line : display_buffer.lines())
@@ -1007,9 +1009,9 @@ struct LineNumbersHighlighter : Highlighter
 private:
     void do_highlight(const Context& context, HighlightPass, DisplayBuffer& display_buffer, BufferRange) override
     {
-        const Face face = get_face("LineNumbers");
-        const Face face_wrapped = get_face("LineNumbersWrapped");
-        const Face face_absolute = get_face("LineNumberCursor");
+        const Face face = line_numbers_face.get();
+        const Face face_wrapped = line_numbers_wrapped_face.get();
+        const Face face_absolute = line_number_cursor_face.get();
         int digit_count = compute_digit_count(context);
 
         char format[16];
@@ -1056,7 +1058,7 @@ private:
 
 void show_matching_char(const Context& context, HighlightPass, DisplayBuffer& display_buffer, BufferRange)
 {
-    const Face face = get_face("MatchingChar");
+    const Face face = matching_char_face.get();
     using CodepointPair = std::pair<Codepoint, Codepoint>;
     static const CodepointPair matching_chars[] = { { '(', ')' }, { '{', '}' }, { '[', ']' }, { '<', '>' } };
     const auto range = display_buffer.range();
@@ -1116,10 +1118,10 @@ HighlighterAndId create_matching_char_highlighter(HighlighterParameters params)
 void highlight_selections(const Context& context, HighlightPass, DisplayBuffer& display_buffer, BufferRange)
 {
     const auto& buffer = context.buffer();
-    const Face primary_face = get_face("PrimarySelection");
-    const Face secondary_face = get_face("SecondarySelection");
-    const Face primary_cursor_face = get_face("PrimaryCursor");
-    const Face secondary_cursor_face = get_face("SecondaryCursor");
+    const Face primary_face = primary_selection_face.get();
+    const Face secondary_face = secondary_selection_face.get();
+    const Face primary_cursor = primary_cursor_face.get();
+    const Face secondary_cursor = secondary_cursor_face.get();
 
     const auto& selections = context.selections();
     for (size_t i = 0; i < selections.size(); ++i)
@@ -1138,14 +1140,14 @@ void highlight_selections(const Context& context, HighlightPass, DisplayBuffer&
         auto& sel = selections[i];
         const bool primary = (i == selections.main_index());
         highlight_range(display_buffer, sel.cursor(), buffer.char_next(sel.cursor()), false,
-                        apply_face(primary ? primary_cursor_face : secondary_cursor_face));
+                        apply_face(primary ? primary_cursor : secondary_cursor));
     }
 }
 
 void expand_unprintable(const Context& context, HighlightPass, DisplayBuffer& display_buffer, BufferRange)
 {
     auto& buffer = context.buffer();
-    auto error = get_face("Error");
+    auto error = error_face.get();
     for (auto& line : display_buffer.lines())
     {
         for (auto atom_it = line.begin(); atom_it != line.end(); ++atom_it)
@@ -1245,7 +1247,7 @@ private:
         auto& buffer = context.buffer();
         update_line_specs_ifn(buffer, line_flags);
 
-        auto def_face = get_face(m_default_face);
+        auto def_face = m_default_face.get();
         Vector<DisplayLine> display_lines;
         auto& lines = line_flags.list;
         try
@@ -1311,7 +1313,7 @@ private:
     }
 
     String m_option_name;
-    String m_default_face;
+    FaceHandle m_default_face;
 };
 
 String option_to_string(InclusiveBufferRange range)
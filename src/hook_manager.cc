@@ -15,19 +15,100 @@ namespace Kakoune
 
 struct HookManager::Hook
 {
+    enum class Filter
+    {
+        Any,     // .*
+        Literal, // no regex special character
+        Prefix,  // literal followed by .*
+        Regex
+    };
+
     String group;
     Regex filter;
     String commands;
+    Filter filter_type;
+    size_t order; // position in its hook list
+
+    static Filter get_filter_type(StringView filter)
+    {
+        auto is_literal = [](StringView str) {
+            return not contains_that(str, [](char c) { return contains(StringView{"\\^$.|?*+()[]{}"}, c); });
+        };
+
+        if (filter == ".*")
+            return Filter::Any;
+        if (filter.length() > 2 and filter.substr(filter.length() - 2) == ".*" and
+            is_literal(filter.substr(0_byte, filter.length() - 2)))
+            return Filter::Prefix;
+        if (is_literal(filter))
+            return Filter::Literal;
+        return Filter::Regex;
+    }
 };
 
+void HookManager::HookList::update_index()
+{
+    any_hooks.clear();
+    regex_hooks.clear();
+    literal_hooks.clear();
+    prefix_hooks.clear();
+    prefix_lengths.clear();
+
+    for (size_t i = 0; i < hooks.size(); ++i)
+    {
+        auto& hook = *hooks[i];
+        hook.order = i;
+        const StringView filter = hook.filter.str();
+        switch (hook.filter_type)
+        {
+        case Hook::Filter::Any: any_hooks.push_back(&hook); break;
+        case Hook::Filter::Regex: regex_hooks.push_back(&hook); break;
+        case Hook::Filter::Literal: literal_hooks[filter].push_back(&hook); break;
+        case Hook::Filter::Prefix:
+        {
+            const ByteCount length = filter.length() - 2;
+            prefix_hooks[filter.substr(0_byte, length)].push_back(&hook);
+            if (not contains(prefix_lengths, length))
+                prefix_lengths.push_back(length);
+            break;
+        }
+        }
+    }
+}
+
+HookManager::HookPtrList HookManager::HookList::candidate_hooks(StringView param) const
+{
+    HookPtrList res = any_hooks;
+    auto add_hooks = [&](const HashMap<String, HookPtrList, MemoryDomain::Hooks>& map, StringView key) {
+        auto it = map.find(key);
+        if (it != map.end())
+            res.insert(res.end(), it->value.begin(), it->value.end());
+    };
+
+    add_hooks(literal_hooks, param);
+    for (auto length : prefix_lengths)
+    {
+        if (length <= param.length())
+            add_hooks(prefix_hooks, param.substr(0_byte, length));
+    }
+    res.insert(res.end(), regex_hooks.begin(), regex_hooks.end());
+
+    // hooks run in the order they were added
+    std::sort(res.begin(), res.end(), [](Hook* lhs, Hook* rhs) { return lhs->order < rhs->order; });
+    return res;
+}
+
 HookManager::HookManager() : m_parent(nullptr) {}
 HookManager::HookManager(HookManager& parent) : SafeCountable{}, m_parent(&parent) {}
 HookManager::~HookManager() = default;
 
 void HookManager::add_hook(StringView hook_name, String group, Regex filter, String commands)
 {
-    auto& hooks = m_hooks[hook_name];
-    hooks.emplace_back(new Hook{std::move(group), std::move(filter), std::move(commands)});
+    auto& hook_list = m_hooks[hook_name];
+    const auto filter_type = Hook::get_filter_type(filter.str());
+    hook_list.hooks.emplace_back(new Hook{std::move(group), std::move(filter), std::move(commands),
+                                          filter_type, hook_list.hooks.size()});
+    hook_list.update_index();
 }
 
 void HookManager::remove_hooks(StringView group)
@@ -36,13 +117,17 @@ void HookManager::remove_hooks(StringView group)
         throw runtime_error("invalid id");
     for (auto& list : m_hooks)
     {
-        auto it = std::remove_if(list.value.begin(), list.value.end(),
+        auto& hooks = list.value.hooks;
+        auto it = std::remove_if(hooks.begin(), hooks.end(),
                                  [&](const std::unique_ptr<Hook>& h)
                                  { return h->group == group; });
+        if (it == hooks.end())
+            continue;
         if (not m_running_hooks.empty()) // we are running some hooks, defer deletion
             m_hooks_trash.insert(m_hooks_trash.end(), std::make_move_iterator(it),
-                                 std::make_move_iterator(list.value.end()));
-        list.value.erase(it, list.value.end());
+                                 std::make_move_iterator(hooks.end()));
+        hooks.erase(it, hooks.end());
+        list.value.update_index();
     }
 }
 
@@ -51,7 +136,7 @@ CandidateList HookManager::complete_hook_group(StringView prefix, ByteCount pos_
     CandidateList res;
     for (auto& list : m_hooks)
     {
-        auto container = list.value | transform([](const std::unique_ptr<Hook>& h) -> const String& { return h->group; });
+        auto container = list.value.hooks | transform([](const std::unique_ptr<Hook>& h) -> const String& { return h->group; });
         for (auto& c : complete(prefix, pos_in_token, container))
         {
             if (!contains(res, c))
@@ -61,6 +146,23 @@ CandidateList HookManager::complete_hook_group(StringView prefix, ByteCount pos_
     return res;
 }
 
+bool HookManager::is_disabled(const Hook& hook, const Regex& disabled_hooks) const
+{
+    if (hook.group.empty() or disabled_hooks.empty())
+        return false;
+
+    if (disabled_hooks.str() != m_disabled_hooks)
+    {
+        m_disabled_hooks = disabled_hooks.str();
+        m_disabled_groups.clear();
+    }
+
+    auto it = m_disabled_groups.find(hook.group);
+    if (it != m_disabled_groups.end())
+        return it->value;
+    return m_disabled_groups.insert({hook.group, regex_match(hook.group.begin(), hook.group.end(), disabled_hooks)});
+}
+
 void HookManager::run_hook(StringView hook_name,
                            StringView param, Context& context) const
 {
@@ -88,21 +190,32 @@ void HookManager::run_hook(StringView hook_name,
             m_hooks_trash.clear();
     });
 
-    const DebugFlags debug_flags = context.options()["debug"].get<DebugFlags>();
+    const DebugFlags debug_flags = context.options().get(debug_option);
     const bool profile = debug_flags & DebugFlags::Profile;
     auto start_time = profile ? Clock::now() : TimePoint{};
 
-    auto& disabled_hooks = context.options()["disabled_hooks"].get<Regex>();
+    auto& disabled_hooks = context.options().get(disabled_hooks_option);
 
-    struct ToRun { Hook* hook; MatchResults<const char*> captures; };
+    struct ToRun { Hook* hook; Vector<StringView> captures; };
     Vector<ToRun> hooks_to_run; // The m_hooks_trash vector ensure hooks wont die during this method
-    for (auto& hook : hook_list->value)
+    for (auto* hook : hook_list->value.candidate_hooks(param))
     {
-        MatchResults<const char*> captures;
-        if ((hook->group.empty() or disabled_hooks.empty() or
-             not regex_match(hook->group.begin(), hook->group.end(), disabled_hooks))
-            and regex_match(param.begin(), param.end(), captures, hook->filter))
-            hooks_to_run.push_back({ hook.get(), std::move(captures) });
+        if (is_disabled(*hook, disabled_hooks))
+            continue;
+
+        // The filters of the other candidates are known to match, and
+        // the whole parameter is their only capture.
+        Vector<StringView> captures{param};
+        if (hook->filter_type == Hook::Filter::Regex)
+        {
+            MatchResults<const char*> results;
+            if (not regex_match(param.begin(), param.end(), results, hook->filter))
+                continue;
+            captures.clear();
+            for (auto capture : results)
+                captures.push_back({capture.first, capture.second});
+        }
+        hooks_to_run.push_back({ hook, std::move(captures) });
     }
 
     bool hook_error = false;
@@ -117,8 +230,7 @@ void HookManager::run_hook(StringView hook_name,
 
             EnvVarMap env_vars{ {"hook_param", param.str()} };
             for (size_t i = 0; i < to_run.captures.size(); ++i)
-                env_vars.insert({format("hook_param_capture_{}", i),
-                                 {to_run.captures[i].first, to_run.captures[i].second}});
+                env_vars.insert({format("hook_param_capture_{}", i), to_run.captures[i].str()});
 
             CommandManager::instance().execute(to_run.hook->commands, context,
                                                { {}, std::move(env_vars) });
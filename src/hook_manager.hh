@@ -5,6 +5,8 @@
 #include "completion.hh"
 #include "safe_ptr.hh"
 
+#include <memory>
+
 namespace Kakoune
 {
 
@@ -29,12 +31,37 @@ private:
     friend class Scope;
 
     struct Hook;
+    using HookPtrList = Vector<Hook*, MemoryDomain::Hooks>;
+
+    // Hooks registered for a hook name, and an index of their filters so
+    // that hooks whose filter is a literal or a literal prefix are found
+    // without running a regex.
+    struct HookList
+    {
+        void update_index();
+        // hooks that may match param, only regex filters remain to be checked
+        HookPtrList candidate_hooks(StringView param) const;
+
+        Vector<std::unique_ptr<Hook>, MemoryDomain::Hooks> hooks;
+
+        HookPtrList any_hooks;
+        HookPtrList regex_hooks;
+        HashMap<String, HookPtrList, MemoryDomain::Hooks> literal_hooks;
+        HashMap<String, HookPtrList, MemoryDomain::Hooks> prefix_hooks;
+        Vector<ByteCount, MemoryDomain::Hooks> prefix_lengths;
+    };
+
+    bool is_disabled(const Hook& hook, const Regex& disabled_hooks) const;
 
     SafePtr<HookManager> m_parent;
-    HashMap<String, Vector<std::unique_ptr<Hook>, MemoryDomain::Hooks>, MemoryDomain::Hooks> m_hooks;
+    HashMap<String, HookList, MemoryDomain::Hooks> m_hooks;
 
     mutable Vector<std::pair<StringView, StringView>, MemoryDomain::Hooks> m_running_hooks;
     mutable Vector<std::unique_ptr<Hook>, MemoryDomain::Hooks> m_hooks_trash;
+
+    // matches of hook groups against the disabled_hooks regex
+    mutable String m_disabled_hooks;
+    mutable HashMap<String, bool, MemoryDomain::Hooks> m_disabled_groups;
 };
 
 }
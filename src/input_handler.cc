@@ -70,7 +70,7 @@ namespace InputModes
 
 std::chrono::milliseconds get_idle_timeout(const Context& context)
 {
-    return std::chrono::milliseconds{context.options()["idle_timeout"].get<int>()};
+    return std::chrono::milliseconds{context.options().get(idle_timeout_option)};
 }
 
 std::chrono::milliseconds get_fs_check_timeout(const Context& context)
@@ -307,19 +307,19 @@ public:
         auto num_sel = context().selections().size();
         auto main_index = context().selections().main_index();
         if (num_sel == 1)
-            atoms.emplace_back(format("{} sel", num_sel), get_face("StatusLineInfo"));
+            atoms.emplace_back(format("{} sel", num_sel), status_line_info_face.get());
         else
-            atoms.emplace_back(format("{} sels ({})", num_sel, main_index + 1), get_face("StatusLineInfo"));
+            atoms.emplace_back(format("{} sels ({})", num_sel, main_index + 1), status_line_info_face.get());
 
         if (m_params.count != 0)
         {
-            atoms.emplace_back(" param=", get_face("StatusLineInfo"));
-            atoms.emplace_back(to_string(m_params.count), get_face("StatusLineValue"));
+            atoms.emplace_back(" param=", status_line_info_face.get());
+            atoms.emplace_back(to_string(m_params.count), status_line_value_face.get());
         }
         if (m_params.reg)
         {
-            atoms.emplace_back(" reg=", get_face("StatusLineInfo"));
-            atoms.emplace_back(StringView(m_params.reg).str(), get_face("StatusLineValue"));
+            atoms.emplace_back(" reg=", status_line_info_face.get());
+            atoms.emplace_back(StringView(m_params.reg).str(), status_line_value_face.get());
         }
         return atoms;
     }
@@ -511,12 +511,12 @@ public:
             m_display_pos = m_cursor_pos + 1 - width;
 
         if (m_cursor_pos == m_line.char_length())
-            return DisplayLine{{ { fix_atom_text(m_line.substr(m_display_pos, width-1)), get_face("StatusLine") },
-                                 { " "_str, get_face("StatusCursor")} } };
+            return DisplayLine{{ { fix_atom_text(m_line.substr(m_display_pos, width-1)), status_line_face.get() },
+                                 { " "_str, status_cursor_face.get()} } };
         else
-            return DisplayLine({ { fix_atom_text(m_line.substr(m_display_pos, m_cursor_pos - m_display_pos)), get_face("StatusLine") },
-                                 { fix_atom_text(m_line.substr(m_cursor_pos,1)), get_face("StatusCursor") },
-                                 { fix_atom_text(m_line.substr(m_cursor_pos+1, width - m_cursor_pos + m_display_pos - 1)), get_face("StatusLine") } });
+            return DisplayLine({ { fix_atom_text(m_line.substr(m_display_pos, m_cursor_pos - m_display_pos)), status_line_face.get() },
+                                 { fix_atom_text(m_line.substr(m_cursor_pos,1)), status_cursor_face.get() },
+                                 { fix_atom_text(m_line.substr(m_cursor_pos+1, width - m_cursor_pos + m_display_pos - 1)), status_line_face.get() } });
     }
 private:
     CharCount m_cursor_pos = 0;
@@ -633,7 +633,7 @@ public:
 
     DisplayLine mode_line() const override
     {
-        return { "menu", get_face("StatusLineMode") };
+        return { "menu", status_line_mode_face.get() };
     }
 
     KeymapMode keymap_mode() const override { return KeymapMode::Menu; }
@@ -891,7 +891,7 @@ public:
 
     DisplayLine mode_line() const override
     {
-        return { "prompt", get_face("StatusLineMode") };
+        return { "prompt", status_line_mode_face.get() };
     }
 
     KeymapMode keymap_mode() const override { return KeymapMode::Prompt; }
@@ -1023,7 +1023,7 @@ public:
 
     DisplayLine mode_line() const override
     {
-        return { "enter key", get_face("StatusLineMode") };
+        return { "enter key", status_line_mode_face.get() };
     }
 
     KeymapMode keymap_mode() const override { return m_keymap_mode; }
@@ -1249,16 +1249,19 @@ public:
             context().hooks().run_hook("InsertMove", key_to_str(key), context());
 
         if (update_completions and enabled() and not transient) // Hooks might have disabled us
+        {
             m_idle_timer.set_next_date(Clock::now() + get_idle_timeout(context()));
+            m_completer.schedule_word_db_update();
+        }
     }
 
     DisplayLine mode_line() const override
     {
         auto num_sel = context().selections().size();
         auto main_index = context().selections().main_index();
-        return {AtomList{ { "insert", get_face("StatusLineMode") },
-                          { " ", get_face("StatusLine") },
-                          { format( "{} sels ({})", num_sel, main_index + 1), get_face("StatusLineInfo") } }};
+        return {AtomList{ { "insert", status_line_mode_face.get() },
+                          { " ", status_line_face.get() },
+                          { format( "{} sels ({})", num_sel, main_index + 1), status_line_info_face.get() } }};
     }
 
     KeymapMode keymap_mode() const override { return KeymapMode::Insert; }
@@ -1268,7 +1271,7 @@ private:
     void move(Type offset)
     {
         auto& selections = context().selections();
-        const ColumnCount tabstop = context().options()["tabstop"].get<int>();
+        const ColumnCount tabstop = context().options().get(tabstop_option);
         for (auto& sel : selections)
         {
             auto cursor = context().buffer().offset_coord(sel.cursor(), offset, tabstop, false);
@@ -1407,6 +1410,11 @@ void InputHandler::pop_mode(InputMode* mode)
     current_mode().on_enabled();
 }
 
+bool InputHandler::in_normal_mode() const
+{
+    return current_mode().keymap_mode() == KeymapMode::Normal;
+}
+
 void InputHandler::reset_normal_mode()
 {
     if (m_mode_stack.size() > 1)
@@ -86,6 +86,8 @@ public:
     char recording_reg() const { return m_recording_reg; }
 
     void reset_normal_mode();
+    // true if waiting for a normal mode command, and not for the next key of one
+    bool in_normal_mode() const;
 
     Context& context() { return m_context; }
     const Context& context() const { return m_context; }
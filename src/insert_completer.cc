@@ -80,10 +80,29 @@ WordDB& get_word_db(const Buffer& buffer)
     static const ValueId word_db_id = get_free_value_id();
     Value& cache_val = buffer.values()[word_db_id];
     if (not cache_val)
-        cache_val = Value(WordDB{buffer});
+        cache_val = Value(WordDB{buffer, not (buffer.flags() & Buffer::Flags::Debug)});
     return cache_val.as<WordDB>();
 }
 
+// Pad the words in menu entries so that the buffer names following them
+// are aligned.
+void align_word_menu_entries(InsertCompletion::CandidateList& candidates)
+{
+    const auto longest = accumulate(candidates, 0_char,
+                                    [](const CharCount& lhs, const InsertCompletion::Candidate& rhs)
+                                    { return std::max(lhs, rhs.completion.char_length()); });
+
+    for (auto& candidate : candidates)
+    {
+        auto& menu_entry = candidate.menu_entry;
+        if (menu_entry.atoms().size() == 3) // word, padding and buffer name
+        {
+            const auto pad_len = longest + 1 - candidate.completion.char_length();
+            *(menu_entry.begin() + 1) = DisplayAtom{String{' ', pad_len}};
+        }
+    }
+}
+
 template<bool other_buffers>
 InsertCompletion complete_word(const SelectionList& sels, const OptionManager& options)
 {
@@ -141,23 +160,52 @@ InsertCompletion complete_word(const SelectionList& sels, const OptionManager& o
             matches.push_back({ m, &buf });
     };
 
-    add_matches(buffer);
+    auto add_buffer_matches = [&] {
+        add_matches(buffer);
 
-    // Remove words that are being edited
-    for (auto& word_count : sel_word_counts)
-    {
-        if (get_word_db(buffer).get_word_occurences(word_count.key) <= word_count.value)
-            unordered_erase(matches, word_count.key);
-    }
+        // Remove words that are being edited
+        for (auto& word_count : sel_word_counts)
+        {
+            if (get_word_db(buffer).get_word_occurences(word_count.key) <= word_count.value)
+                unordered_erase(matches, word_count.key);
+        }
+    };
+
+    if (not other_buffers or buffer.flags() & Buffer::Flags::Debug)
+        add_buffer_matches();
 
     if (other_buffers)
     {
+        // The shared index gets updated along with the buffer word databases
         for (const auto& buf : BufferManager::instance())
         {
-            if (buf.get() == &buffer or buf->flags() & Buffer::Flags::Debug)
-                continue;
-            add_matches(*buf);
+            if (not (buf->flags() & Buffer::Flags::Debug))
+                get_word_db(*buf).update_db();
         }
+
+        // Attribute each word to the current buffer if it appears there
+        // outside of the words being edited, else to the buffer where it
+        // is the most frequent.
+        shared_word_index().for_each_match(prefix, [&](const SharedWordIndex::Word& word,
+                                                        const RankedMatch& match) {
+            auto it = sel_word_counts.find(word.word->strview());
+            const int edited = it != sel_word_counts.end() ? it->value : 0;
+            const Buffer* word_buffer = nullptr;
+            int word_buffer_count = 0;
+            for (auto& buffer_count : word.info)
+            {
+                const bool current = buffer_count.buffer == &buffer;
+                const int count = buffer_count.count - (current ? edited : 0);
+                if (count > 0 and (current or (word_buffer != &buffer and
+                                               count > word_buffer_count)))
+                {
+                    word_buffer = buffer_count.buffer;
+                    word_buffer_count = count;
+                }
+            }
+            if (word_buffer)
+                matches.push_back({match, word_buffer});
+        });
     }
 
     using StaticWords = Vector<String, MemoryDomain::Options>;
@@ -166,32 +214,58 @@ InsertCompletion complete_word(const SelectionList& sels, const OptionManager& o
             matches.emplace_back(match, nullptr);
 
     unordered_erase(matches, prefix);
-    std::sort(matches.begin(), matches.end());
+    const bool truncated = keep_best_matches(matches);
     matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
 
-    const auto longest = accumulate(matches, 0_char,
-                                    [](const CharCount& lhs, const RankedMatchAndBuffer& rhs)
-                                    { return std::max(lhs, rhs.candidate().char_length()); });
-
     InsertCompletion::CandidateList candidates;
     candidates.reserve(matches.size());
     for (auto& m : matches)
     {
         DisplayLine menu_entry;
+        menu_entry.push_back(m.candidate().str());
         if (m.buffer)
         {
-            const auto pad_len = longest + 1 - m.candidate().char_length();
-            menu_entry.push_back(m.candidate().str());
-            menu_entry.push_back(String{' ', pad_len});
+            menu_entry.push_back(String{});
             menu_entry.push_back({ m.buffer->display_name(), get_face("MenuInfo") });
         }
-        else
-            menu_entry.push_back(m.candidate().str());
 
         candidates.push_back({m.candidate().str(), "", std::move(menu_entry)});
     }
+    align_word_menu_entries(candidates);
+
+    // words dropped from a truncated list could match a longer prefix, do not refine it
+    return { std::move(candidates), word_begin, cursor_pos, buffer.timestamp(),
+             truncated ? String{} : prefix.str() };
+}
+
+// Filter and re-rank word completion candidates for a prefix extending the
+// one they were computed for, matching it is more restrictive so no new
+// candidate can appear. Kept candidates are moved to the returned list.
+InsertCompletion::CandidateList refine_word_candidates(ArrayView<InsertCompletion::Candidate> candidates,
+                                                       StringView prefix)
+{
+    struct RankedCandidate
+    {
+        RankedMatch match;
+        int index;
+        bool operator<(const RankedCandidate& other) const { return match < other.match; }
+    };
+    Vector<RankedCandidate> matches;
+    for (int i = 0; i < candidates.size(); ++i)
+    {
+        if (candidates[i].completion == prefix)
+            continue;
+        if (RankedMatch match{candidates[i].completion, prefix})
+            matches.push_back({match, i});
+    }
+    std::sort(matches.begin(), matches.end());
 
-    return { std::move(candidates), word_begin, cursor_pos, buffer.timestamp() };
+    InsertCompletion::CandidateList refined;
+    refined.reserve(matches.size());
+    for (auto& m : matches)
+        refined.push_back(std::move(candidates[m.index]));
+    align_word_menu_entries(refined);
+    return refined;
 }
 
 template<bool require_slash>
@@ -245,7 +319,7 @@ InsertCompletion complete_filename(const SelectionList& sels,
     }
     if (candidates.empty())
         return {};
-    return { std::move(candidates), begin.coord(), pos.coord(), buffer.timestamp() };
+    return { std::move(candidates), begin.coord(), pos.coord(), buffer.timestamp(), {} };
 }
 
 InsertCompletion complete_option(const SelectionList& sels,
@@ -312,14 +386,14 @@ InsertCompletion complete_option(const SelectionList& sels,
                     matches.push_back(std::move(match));
                 }
             }
-            std::sort(matches.begin(), matches.end());
+            keep_best_matches(matches);
             InsertCompletion::CandidateList candidates;
             candidates.reserve(matches.size());
             for (auto& match : matches)
                 candidates.push_back({ match.candidate().str(), match.docstring.str(),
                                        std::move(match.menu_entry) });
 
-            return { std::move(candidates), coord, end, timestamp };
+            return { std::move(candidates), coord, end, timestamp, {} };
         }
     }
     return {};
@@ -351,13 +425,14 @@ InsertCompletion complete_line(const SelectionList& sels, const OptionManager& o
         return {};
     std::sort(candidates.begin(), candidates.end());
     candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
-    return { std::move(candidates), cursor_pos.line, cursor_pos, buffer.timestamp() };
+    return { std::move(candidates), cursor_pos.line, cursor_pos, buffer.timestamp(), {} };
 }
 
 }
 
 InsertCompleter::InsertCompleter(Context& context)
-    : m_context(context), m_options(context.options())
+    : m_context(context), m_options(context.options()),
+      m_word_db_updater{[this](IdleTask&) { return update_word_dbs(); }}
 {
     m_options.register_watcher(*this);
 }
@@ -429,6 +504,9 @@ void InsertCompleter::select(int offset, Vector<Key>& keystrokes)
 
 void InsertCompleter::update()
 {
+    if (try_refine())
+        return;
+
     if (m_explicit_completer and try_complete(m_explicit_completer))
         return;
 
@@ -484,6 +562,57 @@ bool InsertCompleter::setup_ifn()
     return true;
 }
 
+// Word completions do not need to be computed again when the only changes
+// since are insertions extending the completed word, refine them instead.
+bool InsertCompleter::try_refine()
+{
+    if (not m_completions.is_valid() or m_completions.word_prefix.empty())
+        return false;
+
+    const Buffer& buffer = m_context.buffer();
+    const BufferCoord begin = m_completions.begin;
+    const BufferCoord cursor = m_context.selections().main().cursor();
+    if (cursor.line != begin.line or cursor < begin)
+        return false;
+
+    for (auto& change : buffer.changes_since(m_completions.timestamp))
+    {
+        if (change.type != Buffer::Change::Insert or
+            change.begin < begin or change.begin > cursor)
+            return false;
+    }
+
+    const StringView prefix = buffer.substr(begin, cursor);
+    const StringView word_prefix = m_completions.word_prefix;
+    if (prefix.length() < word_prefix.length() or
+        prefix.substr(0, word_prefix.length()) != word_prefix)
+        return false;
+
+    ConstArrayView<Codepoint> extra_word_chars = m_options["extra_word_chars"].get<Vector<Codepoint, MemoryDomain::Options>>();
+    const StringView extension = prefix.substr(word_prefix.length());
+    for (utf8::iterator<const char*> it{extension.begin(), extension}; it != extension.end(); ++it)
+    {
+        if (not is_word(*it, extra_word_chars))
+            return false;
+    }
+
+    // The typed text, which is always the last candidate, is not refined
+    auto& candidates = m_completions.candidates;
+    auto refined = refine_word_candidates({candidates.data(), candidates.size() - 1}, prefix);
+    if (refined.empty())
+        return false;
+
+    candidates = std::move(refined);
+    m_completions.end = cursor;
+    m_completions.timestamp = buffer.timestamp();
+    m_completions.word_prefix = prefix.str();
+
+    m_current_candidate = m_completions.candidates.size();
+    menu_show();
+    m_completions.candidates.push_back({prefix.str(), "", {}});
+    return true;
+}
+
 void InsertCompleter::menu_show()
 {
     if (not m_context.has_client())
@@ -542,6 +671,48 @@ bool InsertCompleter::try_complete(Func complete_func)
     return true;
 }
 
+void InsertCompleter::schedule_word_db_update()
+{
+    m_word_db_update_index = 0;
+    m_word_db_updater.schedule();
+}
+
+// Update one buffer word database per call, starting with the current
+// buffer, returns false once all the ones completion will query are done.
+bool InsertCompleter::update_word_dbs()
+{
+    bool word_buffer = false, word_all = false;
+    for (auto& completer : m_options["completers"].get<InsertCompleterDescList>())
+    {
+        if (completer.mode != InsertCompleterDesc::Word)
+            continue;
+        word_buffer |= *completer.param == "buffer";
+        word_all |= *completer.param == "all";
+    }
+
+    const Buffer& buffer = m_context.buffer();
+    if (m_word_db_update_index++ == 0)
+    {
+        if (word_buffer or word_all)
+            get_word_db(buffer).update_db();
+        return word_all;
+    }
+
+    // buffers might have been closed since last call, so check bounds each time
+    auto& buffers = BufferManager::instance();
+    const size_t count = buffers.end() - buffers.begin();
+    for (size_t index = m_word_db_update_index - 2; index < count;
+         ++index, ++m_word_db_update_index)
+    {
+        const Buffer& buf = **(buffers.begin() + index);
+        if (&buf == &buffer or buf.flags() & Buffer::Flags::Debug)
+            continue;
+        get_word_db(buf).update_db();
+        return index + 1 < count;
+    }
+    return false;
+}
+
 void InsertCompleter::explicit_file_complete()
 {
     try_complete(complete_filename<false>);
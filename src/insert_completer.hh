@@ -4,6 +4,7 @@
 #include "option_manager.hh"
 #include "option.hh"
 #include "display_buffer.hh"
+#include "event_manager.hh"
 #include "vector.hh"
 
 #include "optional.hh"
@@ -69,6 +70,8 @@ struct InsertCompletion
     BufferCoord begin;
     BufferCoord end;
     size_t timestamp = 0;
+    // for word completions, the prefix candidates were computed for
+    String word_prefix;
 
     bool is_valid() const { return not candidates.empty(); }
 };
@@ -85,12 +88,17 @@ public:
     void update();
     void reset();
 
+    // bring word databases up to date when idle, so that
+    // completion does not have to do it on the next update
+    void schedule_word_db_update();
+
     void explicit_file_complete();
     void explicit_word_complete();
     void explicit_line_complete();
 
 private:
     bool setup_ifn();
+    bool try_refine();
 
     template<typename Func>
     bool try_complete(Func complete_func);
@@ -98,6 +106,8 @@ private:
 
     void menu_show();
 
+    bool update_word_dbs();
+
     Context&         m_context;
     OptionManager&   m_options;
     InsertCompletion m_completions;
@@ -105,6 +115,9 @@ private:
 
     using CompleteFunc = InsertCompletion (const SelectionList& sels, const OptionManager& options);
     CompleteFunc* m_explicit_completer = nullptr;
+
+    IdleTask         m_word_db_updater;
+    size_t           m_word_db_update_index = 0;
 };
 
 }
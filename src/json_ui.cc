@@ -17,155 +17,227 @@
 namespace Kakoune
 {
 
-template<typename T>
-String to_json(ArrayView<const T> array)
+struct LineDiff
 {
-    String res;
-    for (auto& elem : array)
+    ConstArrayView<DisplayLine> lines;
+    Vector<int> matches;
+};
+
+// Appends json encodings of values to a buffer, reused across requests
+// so that writing a request does not allocate once it is large enough.
+class JsonWriter
+{
+public:
+    JsonWriter(Vector<char, MemoryDomain::Client>& buffer) : m_buffer{buffer} {}
+
+    JsonWriter& raw(StringView str)
     {
-        if (not res.empty())
-            res += ", ";
-        res += to_json(elem);
+        m_buffer.insert(m_buffer.end(), str.begin(), str.end());
+        return *this;
     }
-    return "[" + res + "]";
-}
 
-template<typename T, MemoryDomain D>
-String to_json(const Vector<T, D>& vec) { return to_json(ArrayView<const T>{vec}); }
+    JsonWriter& raw(char c)
+    {
+        m_buffer.push_back(c);
+        return *this;
+    }
 
-String to_json(int i) { return to_string(i); }
-String to_json(bool b) { return b ? "true" : "false"; }
-String to_json(StringView str)
-{
-    String res;
-    res.reserve(str.length() + 4);
-    res += '"';
-    for (auto it = str.begin(), end = str.end(); it != end; )
+    JsonWriter& value(int i)
     {
-        auto next = std::find_if(it, end, [](char c) {
-            return c == '\\' or c == '"' or (c >= 0 and c <= 0x1F);
-        });
+        char buffer[16];
+        return raw({buffer, buffer + sprintf(buffer, "%i", i)});
+    }
 
-        res += StringView{it, next};
-        if (next == end)
-            break;
+    JsonWriter& value(bool b) { return raw(b ? "true" : "false"); }
 
-        char buf[7] = {'\\', *next, 0};
-        if (*next >= 0 and *next <= 0x1F)
-            sprintf(buf, "\\u%04x", *next);
+    JsonWriter& value(StringView str)
+    {
+        // Bytes that need escaping: '"', '\\' and control characters
+        static const struct EscapeTable
+        {
+            EscapeTable()
+            {
+                for (int c = 0; c < 256; ++c)
+                    needs_escape[c] = c == '"' or c == '\\' or c <= 0x1F;
+            }
+            bool needs_escape[256];
+        } table;
 
-        res += buf;
-        it = next+1;
+        raw('"');
+        for (auto it = str.begin(), end = str.end(); it != end; )
+        {
+            auto next = std::find_if(it, end, [](char c) {
+                return table.needs_escape[(unsigned char)c];
+            });
+
+            raw({it, next});
+            if (next == end)
+                break;
+
+            char buf[7] = {'\\', *next, 0};
+            if (*next >= 0 and *next <= 0x1F)
+                sprintf(buf, "\\u%04x", *next);
+
+            raw(buf);
+            it = next+1;
+        }
+        return raw('"');
     }
-    res += '"';
-    return res;
-}
 
-String to_json(Color color)
-{
-    if (color.color == Kakoune::Color::RGB)
+    JsonWriter& value(Color color)
     {
-        char buffer[10];
-        sprintf(buffer, R"("#%02x%02x%02x")", color.r, color.g, color.b);
-        return buffer;
+        if (color.color == Kakoune::Color::RGB)
+        {
+            char buffer[10];
+            sprintf(buffer, R"("#%02x%02x%02x")", color.r, color.g, color.b);
+            return raw(buffer);
+        }
+        return value(StringView{to_string(color)});
     }
-    return to_json(to_string(color));
-}
 
-String to_json(Attribute attributes)
-{
-    struct Attr { Attribute attr; StringView name; }
-    attrs[] { 
-        { Attribute::Exclusive, "exclusive" },
-        { Attribute::Underline, "underline" },
-        { Attribute::Reverse, "reverse" },
-        { Attribute::Blink, "blink" },
-        { Attribute::Bold, "bold" },
-        { Attribute::Dim, "dim" },
-        { Attribute::Italic, "italic" },
-    };
+    JsonWriter& value(Attribute attributes)
+    {
+        struct Attr { Attribute attr; StringView name; }
+        attrs[] {
+            { Attribute::Exclusive, "exclusive" },
+            { Attribute::Underline, "underline" },
+            { Attribute::Reverse, "reverse" },
+            { Attribute::Blink, "blink" },
+            { Attribute::Bold, "bold" },
+            { Attribute::Dim, "dim" },
+            { Attribute::Italic, "italic" },
+        };
+
+        raw('[');
+        bool first = true;
+        for (auto& attr : attrs)
+        {
+            if (not (attributes & attr.attr))
+                continue;
+            if (not first)
+                raw(',');
+            first = false;
+            value(attr.name);
+        }
+        return raw(']');
+    }
 
-    return "[" + join(attrs |
-                      filter([=](const Attr& a) { return attributes & a.attr; }) |
-                      transform([](const Attr& a) { return to_json(a.name); }),
-                      ',', false) + "]";
-}
+    JsonWriter& value(Face face)
+    {
+        raw(R"({ "fg": )").value(face.fg);
+        raw(R"(, "bg": )").value(face.bg);
+        raw(R"(, "attributes": )").value(face.attributes);
+        return raw(" }");
+    }
 
-String to_json(Face face)
-{
-    return format(R"(\{ "fg": {}, "bg": {}, "attributes": {} })",
-                  to_json(face.fg), to_json(face.bg), to_json(face.attributes));
-}
+    JsonWriter& value(const DisplayAtom& atom)
+    {
+        raw(R"({ "face": )").value(atom.face);
+        raw(R"(, "contents": )").value(atom.content());
+        return raw(" }");
+    }
 
-String to_json(const DisplayAtom& atom)
-{
-    return format(R"(\{ "face": {}, "contents": {} })", to_json(atom.face), to_json(atom.content()));
-}
+    JsonWriter& value(const DisplayLine& line) { return value(line.atoms()); }
 
-String to_json(const DisplayLine& line)
-{
-    return to_json(line.atoms());
-}
+    JsonWriter& value(DisplayCoord coord)
+    {
+        raw(R"({ "line": )").value((int)coord.line);
+        raw(R"(, "column": )").value((int)coord.column);
+        return raw(" }");
+    }
 
-String to_json(DisplayCoord coord)
-{
-    return format(R"(\{ "line": {}, "column": {} })", coord.line, coord.column);
-}
+    JsonWriter& value(MenuStyle style)
+    {
+        switch (style)
+        {
+            case MenuStyle::Prompt: return raw(R"("prompt")");
+            case MenuStyle::Inline: return raw(R"("inline")");
+        }
+        return *this;
+    }
 
-String to_json(MenuStyle style)
-{
-    switch (style)
+    JsonWriter& value(InfoStyle style)
     {
-        case MenuStyle::Prompt: return R"("prompt")";
-        case MenuStyle::Inline: return R"("inline")";
+        switch (style)
+        {
+            case InfoStyle::Prompt: return raw(R"("prompt")");
+            case InfoStyle::Inline: return raw(R"("inline")");
+            case InfoStyle::InlineAbove: return raw(R"("inlineAbove")");
+            case InfoStyle::InlineBelow: return raw(R"("inlineBelow")");
+            case InfoStyle::MenuDoc: return raw(R"("menuDoc")");
+            case InfoStyle::Modal: return raw(R"("modal")");
+        }
+        return *this;
     }
-    return "";
-}
 
-String to_json(InfoStyle style)
-{
-    switch (style)
+    JsonWriter& value(CursorMode mode)
     {
-        case InfoStyle::Prompt: return R"("prompt")";
-        case InfoStyle::Inline: return R"("inline")";
-        case InfoStyle::InlineAbove: return R"("inlineAbove")";
-        case InfoStyle::InlineBelow: return R"("inlineBelow")";
-        case InfoStyle::MenuDoc: return R"("menuDoc")";
-        case InfoStyle::Modal: return R"("modal")";
+        switch (mode)
+        {
+            case CursorMode::Prompt: return raw(R"("prompt")");
+            case CursorMode::Buffer: return raw(R"("buffer")");
+        }
+        return *this;
     }
-    return "";
-}
 
-String to_json(CursorMode mode)
-{
-    switch (mode)
+    template<typename T>
+    JsonWriter& value(ArrayView<const T> array)
     {
-        case CursorMode::Prompt: return R"("prompt")";
-        case CursorMode::Buffer: return R"("buffer")";
+        raw('[');
+        for (auto& elem : array)
+        {
+            if (&elem != array.begin())
+                raw(", ");
+            value(elem);
+        }
+        return raw(']');
     }
-    return "";
-}
 
-String concat()
-{
-    return "";
-}
+    template<typename T, MemoryDomain D>
+    JsonWriter& value(const Vector<T, D>& vec) { return value(ArrayView<const T>{vec}); }
 
-template<typename First, typename... Args>
-String concat(First&& first, Args&&... args)
-{
-    if (sizeof...(Args) != 0)
-        return to_json(first) + ", " + concat(args...);
-    return to_json(first);
-}
+    // Lines that were already sent in the previous frame are replaced with
+    // their index in it.
+    JsonWriter& value(const LineDiff& diff)
+    {
+        raw('[');
+        for (size_t i = 0; i < diff.lines.size(); ++i)
+        {
+            if (i != 0)
+                raw(", ");
+            if (diff.matches[i] != -1)
+                value(diff.matches[i]);
+            else
+                value(diff.lines[i]);
+        }
+        return raw(']');
+    }
+
+    void params() {}
+
+    template<typename First, typename... Args>
+    void params(First&& first, Args&&... args)
+    {
+        value(first);
+        if (sizeof...(Args) != 0)
+            raw(", ");
+        params(std::forward<Args>(args)...);
+    }
+
+private:
+    Vector<char, MemoryDomain::Client>& m_buffer;
+};
 
 template<typename... Args>
-void rpc_call(StringView method, Args&&... args)
+void JsonUI::rpc_call(StringView method, Args&&... args)
 {
-    auto q = format(R"(\{ "jsonrpc": "2.0", "method": "{}", "params": [{}] }{})",
-                    method, concat(std::forward<Args>(args)...), "\n");
+    m_output.clear();
+    JsonWriter writer{m_output};
+    writer.raw(R"({ "jsonrpc": "2.0", "method": ")").raw(method).raw(R"(", "params": [)");
+    writer.params(std::forward<Args>(args)...);
+    writer.raw("] }\n");
 
-    write(1, q);
+    write(1, {m_output.data(), m_output.data() + m_output.size()});
 }
 
 JsonUI::JsonUI()
@@ -180,7 +252,12 @@ JsonUI::JsonUI()
 void JsonUI::draw(const DisplayBuffer& display_buffer,
                   const Face& default_face, const Face& padding_face)
 {
-    rpc_call("draw", display_buffer.lines(), default_face, padding_face);
+    if (not m_draw_diff)
+        return rpc_call("draw", display_buffer.lines(), default_face, padding_face);
+
+    auto& lines = display_buffer.lines();
+    rpc_call("draw_diff", LineDiff{lines, m_draw_tracker.update(lines)},
+             default_face, padding_face);
 }
 
 void JsonUI::draw_status(const DisplayLine& status_line,
@@ -191,11 +268,24 @@ void JsonUI::draw_status(const DisplayLine& status_line,
 }
 
 
-void JsonUI::menu_show(ConstArrayView<DisplayLine> items,
-                       DisplayCoord anchor, Face fg, Face bg,
+void JsonUI::menu_show(ConstArrayView<DisplayLine> items, int item_count,
+                       ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
                        MenuStyle style)
 {
-    rpc_call("menu_show", items, anchor, fg, bg, style);
+    if (items.size() == item_count or not m_on_menu_fetch)
+        return rpc_call("menu_show", items, anchor, fg, bg, style);
+
+    // json clients get the whole menu, fetch the remaining items now
+    m_menu_items.assign(items.begin(), items.end());
+    m_on_menu_fetch(items.size(), item_count - items.size());
+    rpc_call("menu_show", ConstArrayView<DisplayLine>{m_menu_items}, anchor, fg, bg, style);
+    m_menu_items.clear();
+}
+
+void JsonUI::menu_items(int first, ConstArrayView<DisplayLine> items)
+{
+    if (first == m_menu_items.size())
+        m_menu_items.insert(m_menu_items.end(), items.begin(), items.end());
 }
 
 void JsonUI::menu_select(int selected)
@@ -233,6 +323,13 @@ void JsonUI::refresh(bool force)
 void JsonUI::set_ui_options(const Options& options)
 {
     // rpc_call("set_ui_options", options);
+
+    auto it = options.find("json_draw_diff"_sv);
+    const bool draw_diff = it != options.end() and
+                           (it->value == "yes" or it->value == "true");
+    if (draw_diff != m_draw_diff)
+        m_draw_tracker.reset(); // next frame is sent in full
+    m_draw_diff = draw_diff;
 }
 
 DisplayCoord JsonUI::dimensions()
@@ -245,6 +342,11 @@ void JsonUI::set_on_key(OnKeyCallback callback)
     m_on_key = std::move(callback);
 }
 
+void JsonUI::set_on_menu_fetch(OnMenuFetchCallback callback)
+{
+    m_on_menu_fetch = std::move(callback);
+}
+
 using JsonArray = Vector<Value>;
 using JsonObject = HashMap<String, Value>;
 
@@ -264,34 +366,40 @@ parse_json(const char* pos, const char* end)
         skip_while(digit_end, end, is_digit);
         return Result{ Value{str_to_int({pos, digit_end})}, digit_end };
     }
-    if (end - pos > 4 and StringView{pos, pos+4} == "true")
+    if (end - pos >= 4 and StringView{pos, pos+4} == "true")
         return Result{ Value{true}, pos+4 };
-    if (end - pos > 5 and StringView{pos, pos+5} == "false")
+    if (end - pos >= 5 and StringView{pos, pos+5} == "false")
         return Result{ Value{false}, pos+5 };
     if (*pos == '"')
     {
-        String value;
-        bool escaped = false;
+        // Find the closing quote first, so that the value is built at once
         ++pos;
-        for (auto string_end = pos; string_end != end; ++string_end)
+        bool escaped = false, has_escapes = false;
+        auto string_end = pos;
+        for (; string_end != end; ++string_end)
         {
             if (escaped)
-            {
                 escaped = false;
-                value += StringView{pos, string_end};
-                value.back() = *string_end;
-                pos = string_end+1;
-                continue;
-            }
-            if (*string_end == '\\')
-                escaped = true;
-            if (*string_end == '"')
-            {
-                value += StringView{pos, string_end};
-                return Result{std::move(value), string_end+1};
-            }
+            else if (*string_end == '\\')
+                escaped = has_escapes = true;
+            else if (*string_end == '"')
+                break;
         }
-        return {};
+        if (string_end == end)
+            return {};
+
+        if (not has_escapes)
+            return Result{String{pos, string_end}, string_end+1};
+
+        String value;
+        value.reserve(string_end - pos);
+        for (auto it = pos; it != string_end; ++it)
+        {
+            if (*it == '\\')
+                ++it;
+            value += *it;
+        }
+        return Result{std::move(value), string_end+1};
     }
     if (*pos == '[')
     {
@@ -399,9 +507,53 @@ void JsonUI::eval_json(const Value& json)
         throw runtime_error("unknown method");
 }
 
+bool JsonUI::RequestScanner::scan(const char*& pos, const char* end)
+{
+    for (; pos != end; ++pos)
+    {
+        const char c = *pos;
+        if (in_string)
+        {
+            if (escaped)
+                escaped = false;
+            else if (c == '\\')
+                escaped = true;
+            else if (c == '"')
+            {
+                in_string = false;
+                if (depth == 0)
+                    return ++pos, true;
+            }
+        }
+        else if (in_garbage)
+        {
+            if (c == '\n')
+            {
+                in_garbage = false;
+                return ++pos, true;
+            }
+        }
+        else if (c == '"')
+            in_string = true;
+        else if (c == '{' or c == '[')
+            ++depth;
+        else if (c == '}' or c == ']')
+        {
+            if (--depth <= 0)
+            {
+                depth = 0;
+                return ++pos, true;
+            }
+        }
+        else if (depth == 0 and not is_blank(c))
+            in_garbage = true; // not a request, drop the rest of the line
+    }
+    return false;
+}
+
 void JsonUI::parse_requests(EventMode mode)
 {
-    constexpr size_t bufsize = 1024;
+    constexpr size_t bufsize = 4096;
     char buf[bufsize];
     while (fd_readable(0))
     {
@@ -415,32 +567,86 @@ void JsonUI::parse_requests(EventMode mode)
     if (not m_on_key)
         return;
 
-    while (not m_requests.empty())
+    // Each byte is scanned once to find where requests end, complete
+    // requests are then parsed once, and dropped from m_requests together.
+    const char* request_begin = m_requests.begin();
+    const char* pos = m_requests.begin() + (int)m_scanned;
+    const char* end = m_requests.end();
+    while (m_scanner.scan(pos, end))
     {
-        const char* pos = nullptr;
         try
         {
-            Value json;
-            std::tie(json, pos) = parse_json(m_requests);
-            if (json)
-                eval_json(json);
+            Value json = std::get<0>(parse_json(request_begin, pos));
+            if (not json)
+                throw runtime_error("incomplete request");
+            eval_json(json);
         }
         catch (runtime_error& error)
         {
             write(2, format("error while handling requests '{}': '{}'",
-                            m_requests, error.what()));
-            // try to salvage request by dropping its first line
-            pos = std::min(m_requests.end(), find(m_requests, '\n')+1);
+                            StringView{request_begin, pos}, error.what()));
         }
-        if (not pos)
-            break; // unterminated request ?
-
-        m_requests = String{pos, m_requests.end()};
+        request_begin = pos;
     }
+
+    if (request_begin == end)
+        m_requests.clear();
+    else if (request_begin != m_requests.begin())
+        m_requests = String{request_begin, end};
+    m_scanned = (int)(end - request_begin);
 }
 
+UnitTest test_json_request_scanner{[]()
+{
+    auto split = [](StringView input) {
+        JsonUI::RequestScanner scanner;
+        Vector<String> requests;
+        const char* begin = input.begin();
+        const char* pos = begin;
+        while (scanner.scan(pos, input.end()))
+        {
+            requests.push_back(String{begin, pos});
+            begin = pos;
+        }
+        return requests;
+    };
+
+    kak_assert((split(R"({ "a": [1, "]}"] } [2]{)") == Vector<String>{R"({ "a": [1, "]}"] })", " [2]"}));
+    kak_assert((split(R"({ "a": "\"}" }x y)" "\n[]") == Vector<String>{R"({ "a": "\"}" })", "x y\n", "[]"}));
+}};
+
+UnitTest test_json_writer{[]()
+{
+    Vector<char, MemoryDomain::Client> buffer;
+    auto written = [&] { return StringView{buffer.data(), buffer.data() + buffer.size()}; };
+
+    JsonWriter{buffer}.value("a\"b\\c\n\x01 d"_sv);
+    kak_assert(written() == R"("a\"b\\c\u000a\u0001 d")");
+
+    buffer.clear();
+    JsonWriter{buffer}.value(Face{Color::Red, Color{255, 0, 16}, Attribute::Bold | Attribute::Italic});
+    kak_assert(written() == R"({ "fg": "red", "bg": "#ff0010", "attributes": ["bold","italic"] })");
+
+    buffer.clear();
+    JsonWriter{buffer}.value(Vector<int>{1, 2, 3});
+    kak_assert(written() == "[1, 2, 3]");
+}};
+
 UnitTest test_json_parser{[]()
 {
+    {
+        auto value = std::get<0>(parse_json(R"(["a\"b", "c\\", true])"));
+        kak_assert(value and value.is_a<JsonArray>());
+        auto& array = value.as<JsonArray>();
+        kak_assert(array.at(0).as<String>() == "a\"b");
+        kak_assert(array.at(1).as<String>() == "c\\");
+        kak_assert(array.at(2).as<bool>());
+    }
+
+    {
+        kak_assert(not std::get<0>(parse_json(R"({ "method": "ke)")));
+    }
+
     {
         auto value = std::get<0>(parse_json(R"({ "jsonrpc": "2.0", "method": "keys", "params": [ "b", "l", "a", "h" ] })"));
         kak_assert(value);
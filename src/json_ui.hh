@@ -2,6 +2,7 @@
 #define json_ui_hh_INCLUDED
 
 #include "user_interface.hh"
+#include "display_buffer.hh"
 #include "event_manager.hh"
 #include "coord.hh"
 #include "string.hh"
@@ -27,9 +28,10 @@ public:
                      const DisplayLine& mode_line,
                      const Face& default_face) override;
 
-    void menu_show(ConstArrayView<DisplayLine> items,
-                   DisplayCoord anchor, Face fg, Face bg,
+    void menu_show(ConstArrayView<DisplayLine> items, int item_count,
+                   ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
                    MenuStyle style) override;
+    void menu_items(int first, ConstArrayView<DisplayLine> items) override;
     void menu_select(int selected) override;
     void menu_hide() override;
 
@@ -44,17 +46,45 @@ public:
 
     DisplayCoord dimensions() override;
     void set_on_key(OnKeyCallback callback) override;
+    void set_on_menu_fetch(OnMenuFetchCallback callback) override;
     void set_ui_options(const Options& options) override;
 
+    // Finds the end of top level json values in a stream without parsing
+    // them, the scan state is kept between calls so that each byte is
+    // only looked at once.
+    struct RequestScanner
+    {
+        // Advances pos up to the end of the current value, returns false
+        // if end was reached before it.
+        bool scan(const char*& pos, const char* end);
+
+        int depth = 0;
+        bool in_string = false;
+        bool escaped = false;
+        bool in_garbage = false;
+    };
+
 private:
+    template<typename... Args>
+    void rpc_call(StringView method, Args&&... args);
+
     void parse_requests(EventMode mode);
     void eval_json(const Value& value);
 
     FDWatcher m_stdin_watcher;
     OnKeyCallback m_on_key;
+    OnMenuFetchCallback m_on_menu_fetch;
     Vector<Key, MemoryDomain::Client> m_pending_keys;
+    Vector<DisplayLine, MemoryDomain::Display> m_menu_items; // menu being fetched
     DisplayCoord m_dimensions;
     String m_requests;
+
+    RequestScanner m_scanner;
+    ByteCount m_scanned = 0; // bytes of m_requests already scanned
+
+    Vector<char, MemoryDomain::Client> m_output;
+    bool m_draw_diff = false;
+    LineDamageTracker m_draw_tracker;
 };
 
 }
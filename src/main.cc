@@ -7,6 +7,9 @@
 #include "command_manager.hh"
 #include "commands.hh"
 #include "context.hh"
+#include "directory_cache.hh"
+#include "file_index.hh"
+#include "file_watcher.hh"
 #include "event_manager.hh"
 #include "face_registry.hh"
 #include "file.hh"
@@ -23,6 +26,7 @@
 #include "scope.hh"
 #include "shared_string.hh"
 #include "shell_manager.hh"
+#include "terminal_ui.hh"
 #include "string.hh"
 #include "unit_tests.hh"
 #include "window.hh"
@@ -275,6 +279,13 @@ static void check_extra_word_chars(const Vector<Codepoint, MemoryDomain::Options
         throw runtime_error{"blanks are not accepted for extra completion characters"};
 }
 
+const OptionHandle<int> tabstop_option{"tabstop"};
+const OptionHandle<DisplayCoord> scrolloff_option{"scrolloff"};
+const OptionHandle<Regex> disabled_hooks_option{"disabled_hooks"};
+const OptionHandle<int> idle_timeout_option{"idle_timeout"};
+const OptionHandle<DebugFlags> debug_option{"debug"};
+const OptionHandle<Vector<Codepoint, MemoryDomain::Options>> extra_word_chars_option{"extra_word_chars"};
+
 void register_options()
 {
     OptionsRegistry& reg = GlobalScope::instance().option_registry();
@@ -302,6 +313,10 @@ void register_options()
     reg.declare_option("ignored_files",
                        "patterns to ignore when completing filenames",
                        Regex{R"(^(\..*|.*\.(o|so|a))$)"});
+    reg.declare_option("edit_completion",
+                       "filename completion used by the edit commands, either "
+                       "directory by directory or fuzzy over all the project files",
+                       EditCompletion::Directory);
     reg.declare_option("disabled_hooks",
                       "patterns to disable hooks whose group is matched",
                       Regex{});
@@ -357,6 +372,7 @@ static bool convert_to_client_pending = false;
 enum class UIType
 {
     NCurses,
+    Terminal,
     Json,
     Dummy,
 };
@@ -364,6 +380,7 @@ enum class UIType
 UIType parse_ui_type(StringView ui_name)
 {
     if (ui_name == "ncurses") return UIType::NCurses;
+    if (ui_name == "terminal") return UIType::Terminal;
     if (ui_name == "json") return UIType::Json;
     if (ui_name == "dummy") return UIType::Dummy;
 
@@ -375,8 +392,9 @@ std::unique_ptr<UserInterface> make_ui(UIType ui_type)
     struct DummyUI : UserInterface
     {
         DummyUI() { set_signal_handler(SIGINT, SIG_DFL); }
-        void menu_show(ConstArrayView<DisplayLine>, DisplayCoord,
+        void menu_show(ConstArrayView<DisplayLine>, int, ColumnCount, DisplayCoord,
                        Face, Face, MenuStyle) override {}
+        void menu_items(int, ConstArrayView<DisplayLine>) override {}
         void menu_select(int) override {}
         void menu_hide() override {}
 
@@ -389,12 +407,14 @@ std::unique_ptr<UserInterface> make_ui(UIType ui_type)
         void set_cursor(CursorMode, DisplayCoord) override {}
         void refresh(bool) override {}
         void set_on_key(OnKeyCallback) override {}
+        void set_on_menu_fetch(OnMenuFetchCallback) override {}
         void set_ui_options(const Options&) override {}
     };
 
     switch (ui_type)
     {
         case UIType::NCurses: return std::make_unique<NCursesUI>();
+        case UIType::Terminal: return std::make_unique<TerminalUI>();
         case UIType::Json: return std::make_unique<JsonUI>();
         case UIType::Dummy: return std::make_unique<DummyUI>();
     }
@@ -414,66 +434,67 @@ pid_t fork_server_to_background()
     return 0;
 }
 
-std::unique_ptr<UserInterface> create_local_ui(UIType ui_type)
+template<typename UI>
+struct LocalUI : UI
 {
-    if (ui_type != UIType::NCurses)
-        return make_ui(ui_type);
-
-    struct LocalUI : NCursesUI
+    LocalUI()
     {
-        LocalUI()
-        {
-            kak_assert(not local_ui);
-            local_ui = this;
-            m_old_sighup = set_signal_handler(SIGHUP, [](int) {
-                static_cast<LocalUI*>(local_ui)->on_sighup();
-                sighup_raised = 1;
-            });
-
-            m_old_sigtstp = set_signal_handler(SIGTSTP, [](int) {
-                if (ClientManager::instance().count() == 1 and
-                    *ClientManager::instance().begin() == local_client)
-                {
-                    // Suspend normally if we are the only client
-                    auto current = set_signal_handler(SIGTSTP, static_cast<LocalUI*>(local_ui)->m_old_sigtstp);
+        kak_assert(not local_ui);
+        local_ui = this;
+        m_old_sighup = set_signal_handler(SIGHUP, [](int) {
+            static_cast<LocalUI*>(local_ui)->UI::on_sighup();
+            sighup_raised = 1;
+        });
+
+        m_old_sigtstp = set_signal_handler(SIGTSTP, [](int) {
+            if (ClientManager::instance().count() == 1 and
+                *ClientManager::instance().begin() == local_client)
+            {
+                // Suspend normally if we are the only client
+                auto current = set_signal_handler(SIGTSTP, static_cast<LocalUI*>(local_ui)->m_old_sigtstp);
 
-                    sigset_t unblock_sigtstp, old_mask;
-                    sigemptyset(&unblock_sigtstp);
-                    sigaddset(&unblock_sigtstp, SIGTSTP);
-                    sigprocmask(SIG_UNBLOCK, &unblock_sigtstp, &old_mask);
+                sigset_t unblock_sigtstp, old_mask;
+                sigemptyset(&unblock_sigtstp);
+                sigaddset(&unblock_sigtstp, SIGTSTP);
+                sigprocmask(SIG_UNBLOCK, &unblock_sigtstp, &old_mask);
 
-                    raise(SIGTSTP);
+                raise(SIGTSTP);
 
-                    set_signal_handler(SIGTSTP, current);
-                    sigprocmask(SIG_SETMASK, &old_mask, nullptr);
-                }
-                else
-                    convert_to_client_pending = true;
-           });
-        }
+                set_signal_handler(SIGTSTP, current);
+                sigprocmask(SIG_SETMASK, &old_mask, nullptr);
+            }
+            else
+                convert_to_client_pending = true;
+       });
+    }
 
-        ~LocalUI() override
+    ~LocalUI() override
+    {
+        set_signal_handler(SIGHUP, m_old_sighup);
+        set_signal_handler(SIGTSTP, m_old_sigtstp);
+        local_client = nullptr;
+        local_ui = nullptr;
+        if (not convert_to_client_pending and
+            not ClientManager::instance().empty())
         {
-            set_signal_handler(SIGHUP, m_old_sighup);
-            set_signal_handler(SIGTSTP, m_old_sigtstp);
-            local_client = nullptr;
-            local_ui = nullptr;
-            if (not convert_to_client_pending and
-                not ClientManager::instance().empty())
+            if (fork_server_to_background())
             {
-                if (fork_server_to_background())
-                {
-                    this->NCursesUI::~NCursesUI();
-                    exit(local_client_exit);
-                }
+                this->UI::~UI();
+                exit(local_client_exit);
             }
         }
+    }
 
-    private:
-        using SigHandler = void (*)(int);
-        SigHandler m_old_sighup;
-        SigHandler m_old_sigtstp;
-    };
+private:
+    using SigHandler = void (*)(int);
+    SigHandler m_old_sighup;
+    SigHandler m_old_sigtstp;
+};
+
+std::unique_ptr<UserInterface> create_local_ui(UIType ui_type)
+{
+    if (ui_type != UIType::NCurses and ui_type != UIType::Terminal)
+        return make_ui(ui_type);
 
     if (not isatty(1))
         throw startup_error("stdout is not a tty");
@@ -488,7 +509,9 @@ std::unique_ptr<UserInterface> create_local_ui(UIType ui_type)
         create_fifo_buffer("*stdin*", fd, Buffer::Flags::None);
     }
 
-    return std::make_unique<LocalUI>();
+    if (ui_type == UIType::Terminal)
+        return std::make_unique<LocalUI<TerminalUI>>();
+    return std::make_unique<LocalUI<NCursesUI>>();
 }
 
 int run_client(StringView session, StringView client_init,
@@ -561,8 +584,11 @@ int run_server(StringView session, StringView server_init,
     HighlighterRegistry highlighter_registry;
     DefinedHighlighters defined_highlighters;
     FaceRegistry        face_registry;
+    FileWatcher         file_watcher;
     ClientManager       client_manager;
     BufferManager       buffer_manager;
+    DirectoryCache      directory_cache;
+    ProjectFileIndex    project_file_index;
 
     register_options();
     register_env_vars();
@@ -779,9 +805,27 @@ int run_pipe(StringView session)
     return 0;
 }
 
+int run_control(StringView session)
+{
+    try
+    {
+        EventManager event_manager;
+        RemoteControl control{session, 0, 1};
+        while (not control.finished())
+            event_manager.handle_next_events(EventMode::Normal);
+    }
+    catch (disconnected& e)
+    {
+        write_stderr(format("{}\ndisconnecting\n", e.what()));
+        return -1;
+    }
+    return 0;
+}
+
 void signal_handler(int signal)
 {
     NCursesUI::abort();
+    TerminalUI::abort();
     const char* text = nullptr;
     switch (signal)
     {
@@ -838,10 +882,11 @@ int main(int argc, char* argv[])
                    { "s", { true,  "set session name" } },
                    { "d", { false, "run as a headless session (requires -s)" } },
                    { "p", { true,  "just send stdin as commands to the given session" } },
+                   { "control", { true, "send stdin lines as commands to the given session, and write their results to stdout" } },
                    { "f", { true,  "act as a filter, executing given keys on given files" } },
                    { "i", { true, "backup the files on which a filter is applied using the given suffix" } },
                    { "q", { false, "in filter mode, be quiet about errors applying keys" } },
-                   { "ui", { true, "set the type of user interface to use (ncurses, dummy, or json)" } },
+                   { "ui", { true, "set the type of user interface to use (ncurses, terminal, dummy, or json)" } },
                    { "l", { false, "list existing sessions" } },
                    { "clear", { false, "clear dead sessions" } },
                    { "ro", { false, "readonly mode" } },
@@ -894,17 +939,21 @@ int main(int argc, char* argv[])
             return 0;
         }
 
-        if (auto session = parser.get_switch("p"))
+        for (auto remote_opt : { "p", "control" })
         {
-            for (auto opt : { "c", "n", "s", "d", "e", "E", "ro" })
+            auto session = parser.get_switch(remote_opt);
+            if (not session)
+                continue;
+
+            for (auto opt : { "c", "n", "s", "d", "e", "E", "ro", "p", "control" })
             {
-                if (parser.get_switch(opt))
+                if (opt != StringView{remote_opt} and parser.get_switch(opt))
                 {
-                    write_stderr(format("error: -{} is incompatible with -p\n", opt));
+                    write_stderr(format("error: -{} is incompatible with -{}\n", opt, remote_opt));
                     return -1;
                 }
             }
-            return run_pipe(*session);
+            return StringView{remote_opt} == "p" ? run_pipe(*session) : run_control(*session);
         }
 
         auto client_init = parser.get_switch("e").value_or(StringView{});
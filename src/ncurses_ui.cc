@@ -29,41 +29,6 @@ using std::max;
 
 struct NCursesWin : WINDOW {};
 
-static constexpr StringView assistant_cat[] =
-    { R"(  ___            )",
-      R"( (__ \           )",
-      R"(   / /          ╭)",
-      R"(  .' '·.        │)",
-      R"( '      ”       │)",
-      R"( ╰       /\_/|  │)",
-      R"(  | .         \ │)",
-      R"(  ╰_J`    | | | ╯)",
-      R"(      ' \__- _/  )",
-      R"(      \_\   \_\  )",
-      R"(                 )"};
-
-static constexpr StringView assistant_clippy[] =
-    { " ╭──╮   ",
-      " │  │   ",
-      " @  @  ╭",
-      " ││ ││ │",
-      " ││ ││ ╯",
-      " │╰─╯│  ",
-      " ╰───╯  ",
-      "        " };
-
-static constexpr StringView assistant_dilbert[] =
-    { R"(  დოოოოოდ   )",
-      R"(  |     |   )",
-      R"(  |     |  ╭)",
-      R"(  |-ᱛ ᱛ-|  │)",
-      R"( Ͼ   ∪   Ͽ │)",
-      R"(  |     |  ╯)",
-      R"( ˏ`-.ŏ.-´ˎ  )",
-      R"(     @      )",
-      R"(      @     )",
-      R"(            )"};
-
 static void set_attribute(WINDOW* window, int attribute, bool on)
 {
     if (on)
@@ -249,7 +214,7 @@ NCursesUI::NCursesUI()
         while (auto key = get_next_key())
             m_on_key(*key);
       }},
-      m_assistant(assistant_clippy),
+      m_assistant(*find_assistant("clippy")),
       m_colors{default_colors},
       m_cursor{CursorMode::Buffer, {}}
 {
@@ -382,29 +347,58 @@ void NCursesUI::draw(const DisplayBuffer& display_buffer,
                      const Face& default_face,
                      const Face& padding_face)
 {
-    wbkgdset(m_window, COLOR_PAIR(get_color_pair(default_face)));
-
     check_resize();
 
-    LineCount line_index = m_status_on_top ? 1 : 0;
-    for (const DisplayLine& line : display_buffer.lines())
+    const int line_offset = m_status_on_top ? 1 : 0;
+    const auto& lines = display_buffer.lines();
+    const int line_count = (int)lines.size();
+    const bool redraw_all = m_drawn_lines == -1 or
+                            default_face != m_drawn_default_face;
+
+    auto matches = m_draw_tracker.update(lines);
+    int scroll = 0;
+    if (redraw_all)
+        std::fill(matches.begin(), matches.end(), -1);
+    else if (line_count == m_drawn_lines and
+             (scroll = dominant_scroll(matches)) != 0)
+    {
+        // Move reused lines in place, ncurses will then use the terminal
+        // scroll region to update the screen, as idlok is set.
+        scrollok(m_window, true);
+        wsetscrreg(m_window, line_offset, line_offset + line_count - 1);
+        wscrl(m_window, scroll);
+        wsetscrreg(m_window, 0, (int)m_dimensions.line);
+        scrollok(m_window, false);
+    }
+
+    wbkgdset(m_window, COLOR_PAIR(get_color_pair(default_face)));
+
+    for (int i = 0; i < line_count; ++i)
     {
-        wmove(m_window, (int)line_index, 0);
+        if (matches[i] != -1 and matches[i] == i + scroll)
+            continue;
+        wmove(m_window, line_offset + i, 0);
         wclrtoeol(m_window);
-        draw_line(m_window, line, 0, m_dimensions.column, default_face);
-        ++line_index;
+        draw_line(m_window, lines[i], 0, m_dimensions.column, default_face);
     }
 
     wbkgdset(m_window, COLOR_PAIR(get_color_pair(padding_face)));
     set_face(m_window, padding_face, default_face);
 
-    while (line_index < m_dimensions.line + (m_status_on_top ? 1 : 0))
+    if (redraw_all or padding_face != m_drawn_padding_face or
+        line_count < m_drawn_lines)
     {
-        wmove(m_window, (int)line_index++, 0);
-        wclrtoeol(m_window);
-        waddch(m_window, '~');
+        for (int line = line_count; line < (int)m_dimensions.line; ++line)
+        {
+            wmove(m_window, line_offset + line, 0);
+            wclrtoeol(m_window);
+            waddch(m_window, '~');
+        }
     }
 
+    m_drawn_lines = line_count;
+    m_drawn_default_face = default_face;
+    m_drawn_padding_face = padding_face;
     m_dirty = true;
 }
 
@@ -484,6 +478,8 @@ void NCursesUI::check_resize(bool force)
         resize_term(ws.ws_row, ws.ws_col);
 
         m_window = (NCursesWin*)newpad(ws.ws_row, ws.ws_col);
+        m_drawn_lines = -1;
+        idlok(m_window, true);
         intrflush(m_window, false);
         keypad(m_window, true);
         meta(m_window, true);
@@ -494,10 +490,7 @@ void NCursesUI::check_resize(bool force)
             putp(tparm(csr, 0, ws.ws_row));
 
         if (menu)
-        {
-            auto items = std::move(m_menu.items);
-            menu_show(items, m_menu.anchor, m_menu.fg, m_menu.bg, m_menu.style);
-        }
+            create_menu();
         if (info)
             info_show(m_info.title, m_info.content, m_info.anchor, m_info.face, m_info.style);
     }
@@ -659,13 +652,17 @@ void NCursesUI::draw_menu()
     wattron(m_menu.win, COLOR_PAIR(menu_bg));
     wbkgdset(m_menu.win, COLOR_PAIR(menu_bg));
 
-    const int item_count = (int)m_menu.items.size();
+    const int item_count = m_menu.items.size();
     const LineCount menu_lines = div_round_up(item_count, m_menu.columns);
     const LineCount& win_height = m_menu.size.line;
     kak_assert(win_height <= menu_lines);
 
     const ColumnCount column_width = (m_menu.size.column - 1) / m_menu.columns;
 
+    const int first_item = (int)m_menu.top_line * m_menu.columns;
+    m_menu.items.fetch(first_item, first_item + (int)win_height * m_menu.columns,
+                       m_on_menu_fetch);
+
     const LineCount mark_height = min(div_round_up(sq(win_height), menu_lines),
                                       win_height);
     const LineCount mark_line = (win_height - mark_height) * m_menu.top_line /
@@ -680,10 +677,11 @@ void NCursesUI::draw_menu()
             if (item_idx >= item_count)
                 break;
 
-            const DisplayLine& item = m_menu.items[item_idx];
-            draw_line(m_menu.win, item, 0, column_width,
-                      item_idx == m_menu.selected_item ? m_menu.fg : m_menu.bg);
-            const ColumnCount pad = column_width - item.length();
+            const DisplayLine* item = m_menu.items.get(item_idx);
+            if (item)
+                draw_line(m_menu.win, *item, 0, column_width,
+                          item_idx == m_menu.selected_item ? m_menu.fg : m_menu.bg);
+            const ColumnCount pad = column_width - (item ? item->length() : 0);
             add_str(m_menu.win, String{' ', pad});
         }
         const bool is_mark = line >= mark_line and
@@ -696,8 +694,8 @@ void NCursesUI::draw_menu()
     m_dirty = true;
 }
 
-void NCursesUI::menu_show(ConstArrayView<DisplayLine> items,
-                          DisplayCoord anchor, Face fg, Face bg,
+void NCursesUI::menu_show(ConstArrayView<DisplayLine> items, int item_count,
+                          ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
                           MenuStyle style)
 {
     menu_hide();
@@ -706,8 +704,16 @@ void NCursesUI::menu_show(ConstArrayView<DisplayLine> items,
     m_menu.bg = bg;
     m_menu.style = style;
     m_menu.anchor = anchor;
+    m_menu.items.reset(items, item_count);
+    m_menu.longest = longest;
 
-    if (style == MenuStyle::Prompt)
+    create_menu();
+}
+
+void NCursesUI::create_menu()
+{
+    DisplayCoord anchor = m_menu.anchor;
+    if (m_menu.style == MenuStyle::Prompt)
         anchor = DisplayCoord{m_status_on_top ? 0_line : m_dimensions.line, 0};
     else if (m_status_on_top)
         anchor.line += 1;
@@ -717,26 +723,15 @@ void NCursesUI::menu_show(ConstArrayView<DisplayLine> items,
     if (maxsize.column <= 2)
         return;
 
-    const int item_count = items.size();
-    m_menu.items.clear(); // make sure it is empty
-    m_menu.items.reserve(item_count);
-    ColumnCount longest = 1;
-    for (auto& item : items)
-        longest = max(longest, item.length());
-
-    const bool is_prompt = style == MenuStyle::Prompt;
+    const int item_count = m_menu.items.size();
+    const ColumnCount longest = m_menu.longest;
+    const bool is_prompt = m_menu.style == MenuStyle::Prompt;
     m_menu.columns = is_prompt ? max((int)((maxsize.column-1) / (longest+1)), 1) : 1;
 
     ColumnCount maxlen = maxsize.column-1;
     if (m_menu.columns > 1 and item_count > 1)
         maxlen = maxlen / m_menu.columns - 1;
-
-    for (auto& item : items)
-    {
-        m_menu.items.push_back(item);
-        m_menu.items.back().trim(0, maxlen);
-        kak_assert(m_menu.items.back().length() <= maxlen);
-    }
+    m_menu.items.trim(maxlen);
 
     int height = min(10, div_round_up(item_count, m_menu.columns));
 
@@ -755,6 +750,12 @@ void NCursesUI::menu_show(ConstArrayView<DisplayLine> items,
                   m_info.anchor, m_info.face, m_info.style);
 }
 
+void NCursesUI::menu_items(int first, ConstArrayView<DisplayLine> items)
+{
+    m_menu.items.set(first, items);
+    draw_menu();
+}
+
 void NCursesUI::menu_select(int selected)
 {
     const int item_count = m_menu.items.size();
@@ -792,106 +793,6 @@ void NCursesUI::menu_hide()
         info_show(m_info.title, m_info.content, m_info.anchor, m_info.face, m_info.style);
 }
 
-static DisplayCoord compute_pos(DisplayCoord anchor, DisplayCoord size,
-                             NCursesUI::Rect rect, NCursesUI::Rect to_avoid,
-                             bool prefer_above)
-{
-    DisplayCoord pos;
-    if (prefer_above)
-    {
-        pos = anchor - DisplayCoord{size.line};
-        if (pos.line < 0)
-            prefer_above = false;
-    }
-    auto rect_end = rect.pos + rect.size;
-    if (not prefer_above)
-    {
-        pos = anchor + DisplayCoord{1_line};
-        if (pos.line + size.line > rect_end.line)
-            pos.line = max(rect.pos.line, anchor.line - size.line);
-    }
-    if (pos.column + size.column > rect_end.column)
-        pos.column = max(rect.pos.column, rect_end.column - size.column);
-
-    if (to_avoid.size != DisplayCoord{})
-    {
-        DisplayCoord to_avoid_end = to_avoid.pos + to_avoid.size;
-
-        DisplayCoord end = pos + size;
-
-        // check intersection
-        if (not (end.line < to_avoid.pos.line or end.column < to_avoid.pos.column or
-                 pos.line > to_avoid_end.line or pos.column > to_avoid_end.column))
-        {
-            pos.line = min(to_avoid.pos.line, anchor.line) - size.line;
-            // if above does not work, try below
-            if (pos.line < 0)
-                pos.line = max(to_avoid_end.line, anchor.line);
-        }
-    }
-
-    return pos;
-}
-
-Vector<String> make_info_box(StringView title, StringView message, ColumnCount max_width,
-                             ConstArrayView<StringView> assistant)
-{
-    DisplayCoord assistant_size;
-    if (not assistant.empty())
-        assistant_size = { (int)assistant.size(), assistant[0].column_length() };
-
-    Vector<String> result;
-
-    const ColumnCount max_bubble_width = max_width - assistant_size.column - 6;
-    if (max_bubble_width < 4)
-        return result;
-
-    Vector<StringView> lines = wrap_lines(message, max_bubble_width);
-
-    ColumnCount bubble_width = title.column_length() + 2;
-    for (auto& line : lines)
-        bubble_width = max(bubble_width, line.column_length());
-
-    auto line_count = max(assistant_size.line-1,
-                          LineCount{(int)lines.size()} + 2);
-    const auto assistant_top_margin = (line_count - assistant_size.line+1) / 2;
-    for (LineCount i = 0; i < line_count; ++i)
-    {
-        String line;
-        constexpr Codepoint dash{L'─'};
-        if (not assistant.empty())
-        {
-            if (i >= assistant_top_margin)
-                line += assistant[(int)min(i - assistant_top_margin, assistant_size.line-1)];
-            else
-                line += assistant[(int)assistant_size.line-1];
-        }
-        if (i == 0)
-        {
-            if (title.empty())
-                line += "╭─" + String{dash, bubble_width} + "─╮";
-            else
-            {
-                auto dash_count = bubble_width - title.column_length() - 2;
-                String left{dash, dash_count / 2};
-                String right{dash, dash_count - dash_count / 2};
-                line += "╭─" + left + "┤" + title +"├" + right +"─╮";
-            }
-        }
-        else if (i < lines.size() + 1)
-        {
-            auto& info_line = lines[(int)i - 1];
-            const ColumnCount padding = bubble_width - info_line.column_length();
-            line += "│ " + info_line + String{' ', padding} + " │";
-        }
-        else if (i == lines.size() + 1)
-            line += "╰─" + String(dash, bubble_width) + "─╯";
-
-        result.push_back(std::move(line));
-    }
-    return result;
-}
-
 void NCursesUI::info_show(StringView title, StringView content,
                           DisplayCoord anchor, Face face, InfoStyle style)
 {
@@ -979,6 +880,11 @@ void NCursesUI::set_on_key(OnKeyCallback callback)
     m_on_key = std::move(callback);
 }
 
+void NCursesUI::set_on_menu_fetch(OnMenuFetchCallback callback)
+{
+    m_on_menu_fetch = std::move(callback);
+}
+
 DisplayCoord NCursesUI::dimensions()
 {
     return m_dimensions;
@@ -1017,20 +923,17 @@ void NCursesUI::set_ui_options(const Options& options)
 {
     {
         auto it = options.find("ncurses_assistant"_sv);
-        if (it == options.end() or it->value == "clippy")
-            m_assistant = assistant_clippy;
-        else if (it->value == "cat")
-            m_assistant = assistant_cat;
-        else if (it->value == "dilbert")
-            m_assistant = assistant_dilbert;
-        else if (it->value == "none" or it->value == "off")
-            m_assistant = ConstArrayView<StringView>{};
+        if (auto assistant = find_assistant(it != options.end() ? it->value : "clippy"))
+            m_assistant = *assistant;
     }
 
     {
         auto it = options.find("ncurses_status_on_top"_sv);
-        m_status_on_top = it != options.end() and
+        const bool status_on_top = it != options.end() and
             (it->value == "yes" or it->value == "true");
+        if (status_on_top != m_status_on_top)
+            m_drawn_lines = -1;
+        m_status_on_top = status_on_top;
     }
 
     {
@@ -1053,6 +956,7 @@ void NCursesUI::set_ui_options(const Options& options)
             m_next_color = 16;
             m_next_pair = 1;
             m_active_pair = -1;
+            m_drawn_lines = -1;
         }
         m_change_colors = value;
     }
@@ -3,11 +3,13 @@
 
 #include "array_view.hh"
 #include "coord.hh"
+#include "display_buffer.hh"
 #include "event_manager.hh"
 #include "face.hh"
 #include "hash_map.hh"
 #include "optional.hh"
 #include "string.hh"
+#include "ui_layout.hh"
 #include "user_interface.hh"
 
 namespace Kakoune
@@ -32,9 +34,10 @@ public:
                      const DisplayLine& mode_line,
                      const Face& default_face) override;
 
-    void menu_show(ConstArrayView<DisplayLine> items,
-                   DisplayCoord anchor, Face fg, Face bg,
+    void menu_show(ConstArrayView<DisplayLine> items, int item_count,
+                   ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
                    MenuStyle style) override;
+    void menu_items(int first, ConstArrayView<DisplayLine> items) override;
     void menu_select(int selected) override;
     void menu_hide() override;
 
@@ -49,16 +52,11 @@ public:
 
     DisplayCoord dimensions() override;
     void set_on_key(OnKeyCallback callback) override;
+    void set_on_menu_fetch(OnMenuFetchCallback callback) override;
     void set_ui_options(const Options& options) override;
 
     static void abort();
 
-    struct Rect
-    {
-        DisplayCoord pos;
-        DisplayCoord size;
-    };
-
 protected:
     void on_sighup();
 
@@ -79,6 +77,13 @@ private:
 
     DisplayCoord m_dimensions;
 
+    // Content of m_window's display lines, so that draw only touches
+    // the lines that changed. m_drawn_lines is -1 when it is unknown.
+    LineDamageTracker m_draw_tracker;
+    Face m_drawn_default_face;
+    Face m_drawn_padding_face;
+    int m_drawn_lines = -1;
+
     using ColorPair = std::pair<Color, Color>;
     HashMap<Color, int, MemoryDomain::Faces> m_colors;
     HashMap<ColorPair, int, MemoryDomain::Faces> m_colorpairs;
@@ -101,7 +106,8 @@ private:
 
     struct Menu : Window
     {
-        Vector<DisplayLine, MemoryDomain::Display> items;
+        MenuItems items;
+        ColumnCount longest = 1;
         Face fg;
         Face bg;
         DisplayCoord anchor;
@@ -111,6 +117,7 @@ private:
         LineCount top_line = 0;
     } m_menu;
 
+    void create_menu();
     void draw_menu();
 
     struct Info : Window
@@ -130,6 +137,7 @@ private:
 
     FDWatcher m_stdin_watcher;
     OnKeyCallback m_on_key;
+    OnMenuFetchCallback m_on_menu_fetch;
 
     bool m_status_on_top = false;
     ConstArrayView<StringView> m_assistant;
@@ -489,6 +489,84 @@ void apply_diff(Buffer& buffer, BufferCoord pos, StringView before, StringView a
     }
 }
 
+static Vector<StringView> split_lines(StringView str)
+{
+    Vector<StringView> lines;
+    for (auto it = str.begin(), end = str.end(); it != end; )
+    {
+        auto eol = std::find(it, end, '\n');
+        if (eol != end)
+            ++eol;
+        lines.push_back({it, eol});
+        it = eol;
+    }
+    return lines;
+}
+
+// Diff by lines first and only diff the modified lines byte by byte, so that
+// replacing a large text, such as a whole buffer piped through a formatter,
+// stays fast.
+void apply_line_diff(Buffer& buffer, BufferCoord pos, StringView before, StringView after)
+{
+    // modified hunks larger than that are replaced as a whole
+    constexpr ByteCount max_refined_length = 4096;
+
+    auto lines_before = split_lines(before);
+    auto lines_after = split_lines(after);
+    auto diffs = find_hashed_diff(lines_before.begin(), (int)lines_before.size(),
+                                  lines_after.begin(), (int)lines_after.size(),
+                                  [](StringView line) { return hash_value(line); });
+
+    auto line_range = [](ConstArrayView<StringView> lines, int first, int count) {
+        return count == 0 ? StringView{} : StringView{lines[first].begin(), lines[first + count - 1].end()};
+    };
+
+    int line = 0;
+    for (auto it = diffs.begin(); it != diffs.end(); )
+    {
+        if (it->mode == Diff::Keep)
+        {
+            pos = buffer.advance(pos, line_range(lines_before, line, it->len).length());
+            line += (it++)->len;
+            continue;
+        }
+
+        // removed lines and added lines between two kept ones are contiguous
+        int removed_count = 0, added_count = 0, added_first = 0;
+        for (; it != diffs.end() and it->mode != Diff::Keep; ++it)
+        {
+            if (it->mode == Diff::Remove)
+                removed_count += it->len;
+            else
+            {
+                if (added_count == 0)
+                    added_first = it->posB;
+                added_count += it->len;
+            }
+        }
+
+        auto removed = line_range(lines_before, line, removed_count);
+        auto added = line_range(lines_after, added_first, added_count);
+        line += removed_count;
+
+        if (removed.length() + added.length() <= max_refined_length)
+        {
+            apply_diff(buffer, pos, removed, added);
+            pos = buffer.advance(pos, added.length());
+        }
+        else
+        {
+            if (not removed.empty())
+                buffer.erase(pos, buffer.advance(pos, removed.length()));
+            if (not added.empty())
+            {
+                buffer.insert(pos, added);
+                pos = buffer.advance(pos, added.length());
+            }
+        }
+    }
+}
+
 template<bool replace>
 void pipe(Context& context, NormalParams)
 {
@@ -539,7 +617,7 @@ void pipe(Context& context, NormalParams)
                         if (not out.empty() and out.back() == '\n')
                             out.resize(out.length()-1, 0);
                     }
-                    apply_diff(buffer, beg, in, out);
+                    apply_line_diff(buffer, beg, in, out);
 
                     changes_tracker.update(buffer, timestamp);
                 }
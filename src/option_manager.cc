@@ -2,6 +2,8 @@
 
 #include "assert.hh"
 #include "flags.hh"
+#include "scope.hh"
+#include "unit_tests.hh"
 
 namespace Kakoune
 {
@@ -13,6 +15,9 @@ OptionDesc::OptionDesc(String name, String docstring, OptionFlags flags)
 Option::Option(const OptionDesc& desc, OptionManager& manager)
     : m_manager(manager), m_desc(desc) {}
 
+size_t OptionManager::ms_generation = 0;
+int OptionManager::ms_handle_count = 0;
+
 OptionManager::OptionManager(OptionManager& parent)
     : m_parent(&parent)
 {
@@ -54,6 +59,7 @@ Option& OptionManager::get_local_option(StringView name)
     else if (m_parent)
     {
         auto* clone = (*m_parent)[name].clone(*this);
+        ++ms_generation;
         return *m_options.insert({clone->name(), std::unique_ptr<Option>{clone}});
     }
     else
@@ -77,12 +83,25 @@ const Option& OptionManager::operator[](StringView name) const
     return const_cast<OptionManager&>(*this)[name];
 }
 
+void OptionManager::set_resolved_option(int handle_id, const Option& option) const
+{
+    if (m_resolved_generation != ms_generation)
+    {
+        m_resolved_options.clear();
+        m_resolved_generation = ms_generation;
+    }
+    if (handle_id >= m_resolved_options.size())
+        m_resolved_options.resize(handle_id + 1, nullptr);
+    m_resolved_options[handle_id] = &option;
+}
+
 void OptionManager::unset_option(StringView name)
 {
     kak_assert(m_parent); // cannot unset option on global manager
     if (m_options.contains(name))
     {
         m_options.erase(name);
+        ++ms_generation;
         on_option_changed((*m_parent)[name]);
     }
 }
@@ -126,4 +145,23 @@ CandidateList OptionsRegistry::complete_option_name(StringView prefix,
                     transform(std::mem_fn(&OptionDesc::name)));
 }
 
+UnitTest test_option_handles{[]()
+{
+    auto& global = GlobalScope::instance().options();
+    OptionManager child{global};
+    OptionManager grand_child{child};
+
+    const int value = global.get(tabstop_option);
+    auto restore = on_scope_end([&] { global["tabstop"].set<int>(value); });
+
+    kak_assert(grand_child.get(tabstop_option) == value);
+    // overriding with the same value does not notify, but must still be seen
+    child.get_local_option("tabstop").set<int>(value);
+    global["tabstop"].set<int>(value + 1);
+    kak_assert(global.get(tabstop_option) == value + 1);
+    kak_assert(grand_child.get(tabstop_option) == value);
+    child.unset_option("tabstop");
+    kak_assert(grand_child.get(tabstop_option) == value + 1);
+}};
+
 }
@@ -72,6 +72,23 @@ protected:
     const OptionDesc& m_desc;
 };
 
+// Typed reference to an option by name, OptionManager::get caches where
+// the option is found for each handle, so that accessing it does not need
+// to look it up by name through the scopes each time.
+template<typename T>
+class OptionHandle
+{
+public:
+    explicit OptionHandle(const char* name);
+
+    StringView name() const { return m_name; }
+    int id() const { return m_id; }
+
+private:
+    const char* m_name;
+    int m_id;
+};
+
 class OptionManagerWatcher
 {
 public:
@@ -88,6 +105,9 @@ public:
     const Option& operator[] (StringView name) const;
     Option& get_local_option(StringView name);
 
+    template<typename T>
+    const T& get(const OptionHandle<T>& handle) const;
+
     void unset_option(StringView name);
 
     using OptionList = Vector<const Option*>;
@@ -104,10 +124,27 @@ private:
     friend class Scope;
     friend class OptionsRegistry;
 
+    template<typename T> friend class OptionHandle;
+
+    const Option* resolved_option(int handle_id) const
+    {
+        return m_resolved_generation == ms_generation and handle_id < m_resolved_options.size()
+            ? m_resolved_options[handle_id] : nullptr;
+    }
+    void set_resolved_option(int handle_id, const Option& option) const;
+
     HashMap<StringView, std::unique_ptr<Option>, MemoryDomain::Options> m_options;
     OptionManager* m_parent;
 
     mutable Vector<OptionManagerWatcher*, MemoryDomain::Options> m_watchers;
+
+    // Options resolved through handles, indexed by handle id. The options
+    // they resolve to can only change when an option is added to or
+    // removed from a manager, which increments the generation.
+    mutable Vector<const Option*, MemoryDomain::Options> m_resolved_options;
+    mutable size_t m_resolved_generation = 0;
+    static size_t ms_generation;
+    static int ms_handle_count;
 };
 
 template<typename T>
@@ -193,6 +230,23 @@ template<typename T> bool Option::is_of_type() const
     return dynamic_cast<const TypedOption<T>*>(this) != nullptr;
 }
 
+template<typename T>
+OptionHandle<T>::OptionHandle(const char* name)
+    : m_name{name}, m_id{OptionManager::ms_handle_count++} {}
+
+template<typename T>
+const T& OptionManager::get(const OptionHandle<T>& handle) const
+{
+    // the type was checked when the option got resolved
+    if (auto* option = resolved_option(handle.id()))
+        return static_cast<const TypedOption<T>*>(option)->get();
+
+    auto& option = (*this)[handle.name()];
+    auto& value = option.template get<T>();
+    set_resolved_option(handle.id(), option);
+    return value;
+}
+
 class OptionsRegistry
 {
 public:
@@ -243,6 +297,17 @@ private:
     Vector<std::unique_ptr<const OptionDesc>, MemoryDomain::Options> m_descs;
 };
 
+class Regex;
+struct DisplayCoord;
+
+// Handles to the builtin options declared by register_options
+extern const OptionHandle<int> tabstop_option;
+extern const OptionHandle<DisplayCoord> scrolloff_option;
+extern const OptionHandle<Regex> disabled_hooks_option;
+extern const OptionHandle<int> idle_timeout_option;
+extern const OptionHandle<DebugFlags> debug_option;
+extern const OptionHandle<Vector<Codepoint, MemoryDomain::Options>> extra_word_chars_option;
+
 }
 
 #endif // option_manager_hh_INCLUDED
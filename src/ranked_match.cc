@@ -4,8 +4,14 @@
 #include "unit_tests.hh"
 #include "utf8_iterator.hh"
 #include "optional.hh"
+#include "string_utils.hh"
 
 #include <algorithm>
+#include <vector>
+#include <system_error>
+
+#include <signal.h>
+#include <string.h>
 
 namespace Kakoune
 {
@@ -34,32 +40,71 @@ bool matches(UsedLetters query, UsedLetters letters)
     return (query & letters) == query;
 }
 
-using Utf8It = utf8::iterator<const char*>;
+// Codepoint decoding and classification used for matching
+struct UnicodeText
+{
+    static Codepoint read(const char*& it, const char* end) { return utf8::read_codepoint(it, end); }
+    static bool is_lower(Codepoint c) { return iswlower((wchar_t)c); }
+    static bool is_upper(Codepoint c) { return iswupper((wchar_t)c); }
+    static bool is_alnum(Codepoint c) { return iswalnum((wchar_t)c); }
+    static bool is_word(Codepoint c) { return Kakoune::is_word(c); }
+    static Codepoint to_lower(Codepoint c) { return Kakoune::to_lower(c); }
+};
+
+// Pure ASCII strings, by far the most common, do not need utf8 decoding
+// nor locale dependent classification.
+struct AsciiText
+{
+    static Codepoint read(const char*& it, const char*) { return *it++; }
+    static bool is_lower(Codepoint c) { return c >= 'a' and c <= 'z'; }
+    static bool is_upper(Codepoint c) { return c >= 'A' and c <= 'Z'; }
+    static bool is_alnum(Codepoint c) { return is_lower(c) or is_upper(c) or (c >= '0' and c <= '9'); }
+    static bool is_word(Codepoint c) { return c == '_' or is_alnum(c); }
+    static Codepoint to_lower(Codepoint c) { return is_upper(c) ? c - 'A' + 'a' : c; }
+};
+
+// Check 8 bytes at a time for one with its high bit set
+static bool is_ascii(StringView str)
+{
+    uint64_t bits = 0;
+    const char* it = str.begin();
+    const char* end = str.end();
+    for (; end - it >= 8; it += 8)
+    {
+        uint64_t word;
+        memcpy(&word, it, 8);
+        bits |= word;
+    }
+    for (; it != end; ++it)
+        bits |= (unsigned char)*it;
+    return (bits & 0x8080808080808080) == 0;
+}
 
+template<typename Text>
 static int count_word_boundaries_match(StringView candidate, StringView query)
 {
     int count = 0;
-    Utf8It query_it{query.begin(), query};
+    const char* query_it = query.begin();
     Codepoint prev = 0;
-    for (Utf8It it{candidate.begin(), candidate}; it != candidate.end(); ++it)
+    for (const char* it = candidate.begin(); it != candidate.end();)
     {
-        const Codepoint c = *it;
+        const Codepoint c = Text::read(it, candidate.end());
         const bool is_word_boundary = prev == 0 or
-                                      (!iswalnum((wchar_t)prev) and iswalnum((wchar_t)c)) or
-                                      (iswlower((wchar_t)prev) and iswupper((wchar_t)c));
+                                      (!Text::is_alnum(prev) and Text::is_alnum(c)) or
+                                      (Text::is_lower(prev) and Text::is_upper(c));
         prev = c;
 
         if (not is_word_boundary)
             continue;
 
-        const Codepoint lc = to_lower(c);
-        for (auto qit = query_it; qit != query.end(); ++qit)
+        const Codepoint lc = Text::to_lower(c);
+        for (const char* qit = query_it; qit != query.end();)
         {
-            const Codepoint qc = *qit;
-            if (qc == (iswlower((wchar_t)qc) ? lc  : c))
+            const Codepoint qc = Text::read(qit, query.end());
+            if (qc == (Text::is_lower(qc) ? lc  : c))
             {
                 ++count;
-                query_it = qit+1;
+                query_it = qit;
                 break;
             }
         }
@@ -69,9 +114,10 @@ static int count_word_boundaries_match(StringView candidate, StringView query)
     return count;
 }
 
+template<typename Text>
 static bool smartcase_eq(Codepoint candidate, Codepoint query)
 {
-    return query == (iswlower((wchar_t)query) ? to_lower(candidate) : candidate);
+    return query == (Text::is_lower(query) ? Text::to_lower(candidate) : candidate);
 }
 
 struct SubseqRes
@@ -80,6 +126,7 @@ struct SubseqRes
     bool single_word;
 };
 
+template<typename Text>
 static Optional<SubseqRes> subsequence_match_smart_case(StringView str, StringView subseq)
 {
     bool single_word = true;
@@ -90,14 +137,14 @@ static Optional<SubseqRes> subsequence_match_smart_case(StringView str, StringVi
     {
         if (it == str.end())
             return {};
-        const Codepoint c = utf8::read_codepoint(subseq_it, subseq.end());
+        const Codepoint c = Text::read(subseq_it, subseq.end());
         while (true)
         {
-            auto str_c = utf8::read_codepoint(it, str.end());
-            if (smartcase_eq(str_c, c))
+            auto str_c = Text::read(it, str.end());
+            if (smartcase_eq<Text>(str_c, c))
                 break;
 
-            if (max_index != -1 and single_word and  not is_word(str_c))
+            if (max_index != -1 and single_word and not Text::is_word(str_c))
                 single_word = false;
 
             ++index;
@@ -124,7 +171,16 @@ RankedMatch::RankedMatch(StringView candidate, StringView query, TestFunc func)
     if (not func())
         return;
 
-    auto res = subsequence_match_smart_case(candidate, query);
+    if (is_ascii(candidate) and is_ascii(query))
+        compute<AsciiText>(candidate, query);
+    else
+        compute<UnicodeText>(candidate, query);
+}
+
+template<typename Text>
+void RankedMatch::compute(StringView candidate, StringView query)
+{
+    auto res = subsequence_match_smart_case<Text>(candidate, query);
     if (not res)
         return;
 
@@ -133,11 +189,11 @@ RankedMatch::RankedMatch(StringView candidate, StringView query, TestFunc func)
 
     if (res->single_word)
         m_flags |= Flags::SingleWord;
-    if (smartcase_eq(candidate[0], query[0]))
+    if (smartcase_eq<Text>(candidate[0], query[0]))
         m_flags |= Flags::FirstCharMatch;
 
     auto it = std::search(candidate.begin(), candidate.end(),
-                          query.begin(), query.end(), smartcase_eq);
+                          query.begin(), query.end(), smartcase_eq<Text>);
     if (it != candidate.end())
     {
         m_flags |= Flags::Contiguous;
@@ -153,7 +209,7 @@ RankedMatch::RankedMatch(StringView candidate, StringView query, TestFunc func)
         }
     }
 
-    m_word_boundary_match_count = count_word_boundaries_match(candidate, query);
+    m_word_boundary_match_count = count_word_boundaries_match<Text>(candidate, query);
     if (m_word_boundary_match_count == query.length())
         m_flags |= Flags::OnlyWordBoundary;
 }
@@ -217,12 +273,74 @@ bool RankedMatch::operator<(const RankedMatch& other) const
     }
 }
 
+Vector<RankedMatch> ranked_matches(ConstArrayView<StringView> candidates, StringView query,
+                                   size_t min_chunk_size, size_t worker_count)
+{
+    auto match_range = [&](size_t begin, size_t end, auto& res) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (RankedMatch match{candidates[i], query})
+                res.push_back(match);
+        }
+    };
+
+    // Only lists taking milliseconds to match are worth the thread overhead
+    const size_t chunk_count = std::min<size_t>(worker_count,
+                                                candidates.size() / min_chunk_size);
+    Vector<RankedMatch> res;
+    if (chunk_count <= 1)
+    {
+        match_range(0, candidates.size(), res);
+        return res;
+    }
+
+    const size_t chunk_size = (candidates.size() + chunk_count - 1) / chunk_count;
+    // Memory domain accounting is not thread safe, workers only allocate
+    // through the standard allocator.
+    std::vector<std::vector<RankedMatch>> chunk_matches(chunk_count);
+    auto match_chunk = [&](size_t chunk) {
+        match_range(chunk * chunk_size, std::min((chunk + 1) * chunk_size, candidates.size()),
+                    chunk_matches[chunk]);
+    };
+
+    // Signals should still be handled by the main thread, workers inherit
+    // the signal mask in effect when they are created.
+    sigset_t mask, orig_mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &orig_mask);
+    Vector<std::thread> threads;
+    for (size_t chunk = 1; chunk < chunk_count; ++chunk)
+    {
+        try
+        {
+            threads.emplace_back(match_chunk, chunk);
+        }
+        catch (std::system_error&)
+        {
+            match_chunk(chunk);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &orig_mask, nullptr);
+
+    match_chunk(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    size_t count = 0;
+    for (auto& matches : chunk_matches)
+        count += matches.size();
+    res.reserve(count);
+    for (auto& matches : chunk_matches)
+        res.insert(res.end(), matches.begin(), matches.end());
+    return res;
+}
+
 UnitTest test_ranked_match{[] {
-    kak_assert(count_word_boundaries_match("run_all_tests", "rat") == 3);
-    kak_assert(count_word_boundaries_match("run_all_tests", "at") == 2);
-    kak_assert(count_word_boundaries_match("countWordBoundariesMatch", "wm") == 2);
-    kak_assert(count_word_boundaries_match("countWordBoundariesMatch", "cobm") == 3);
-    kak_assert(count_word_boundaries_match("countWordBoundariesMatch", "cWBM") == 4);
+    kak_assert(count_word_boundaries_match<UnicodeText>("run_all_tests", "rat") == 3);
+    kak_assert(count_word_boundaries_match<UnicodeText>("run_all_tests", "at") == 2);
+    kak_assert(count_word_boundaries_match<UnicodeText>("countWordBoundariesMatch", "wm") == 2);
+    kak_assert(count_word_boundaries_match<UnicodeText>("countWordBoundariesMatch", "cobm") == 3);
+    kak_assert(count_word_boundaries_match<UnicodeText>("countWordBoundariesMatch", "cWBM") == 4);
     kak_assert(RankedMatch{"source", "so"} < RankedMatch{"source_data", "so"});
     kak_assert(not (RankedMatch{"source_data", "so"} < RankedMatch{"source", "so"}));
     kak_assert(not (RankedMatch{"source", "so"} < RankedMatch{"source", "so"}));
@@ -232,6 +350,47 @@ UnitTest test_ranked_match{[] {
     kak_assert(RankedMatch{"create_task", "ct"} < RankedMatch{"constructor", "ct"});
     kak_assert(RankedMatch{"class", "cla"} < RankedMatch{"class::attr", "cla"});
     kak_assert(RankedMatch{"meta/", "meta"} < RankedMatch{"meta-a/", "meta"});
+
+    kak_assert(is_ascii("run_all_tests") and is_ascii(""));
+    kak_assert(not is_ascii("run_all_testé") and not is_ascii("éa"));
+
+    // the ascii fast path must behave exactly as the generic one
+    const char* words[] = { "run_all_tests", "countWordBoundariesMatch", "Class::attr",
+                            "foo/bar/foobar", "meta-a/", "SOURCE_data", "x", "ruNalLtestS" };
+    const char* queries[] = { "rat", "at", "cWBM", "cobm", "cla", "foobar", "so", "SO", "a", "ts" };
+    for (auto& word : words)
+    {
+        for (auto& query : queries)
+        {
+            kak_assert(count_word_boundaries_match<AsciiText>(word, query) ==
+                       count_word_boundaries_match<UnicodeText>(word, query));
+            auto ascii = subsequence_match_smart_case<AsciiText>(word, query);
+            auto unicode = subsequence_match_smart_case<UnicodeText>(word, query);
+            kak_assert((bool)ascii == (bool)unicode);
+            kak_assert(not ascii or (ascii->max_index == unicode->max_index and
+                                     ascii->single_word == unicode->single_word));
+        }
+    }
+}};
+
+UnitTest test_ranked_matches{[] {
+    Vector<String> strings;
+    for (int i = 0; i < 40; ++i)
+        strings.push_back(format("candidate_{}", i));
+    Vector<StringView> candidates{strings.begin(), strings.end()};
+
+    // uneven chunks, matched by worker threads whatever the machine
+    auto matches = ranked_matches(candidates, "c3", 8, 3);
+    size_t index = 0;
+    for (auto& candidate : candidates)
+    {
+        if (RankedMatch match{candidate, "c3"})
+        {
+            kak_assert(index < matches.size() and matches[index].candidate().begin() == candidate.begin());
+            ++index;
+        }
+    }
+    kak_assert(index == matches.size() and index > 0);
 }};
 
 UnitTest test_used_letters{[]()
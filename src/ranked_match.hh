@@ -3,6 +3,10 @@
 
 #include "string.hh"
 #include "meta.hh"
+#include "vector.hh"
+
+#include <algorithm>
+#include <thread>
 
 namespace Kakoune
 {
@@ -32,6 +36,8 @@ struct RankedMatch
 private:
     template<typename TestFunc>
     RankedMatch(StringView candidate, StringView query, TestFunc test);
+    template<typename Text>
+    void compute(StringView candidate, StringView query);
 
     enum class Flags : int
     {
@@ -53,6 +59,32 @@ private:
     int m_max_index = 0;
 };
 
+// Match all candidates against query, returning the matching ones in their
+// original order. Candidate lists of at least two chunks of min_chunk_size
+// are split between up to worker_count threads.
+Vector<RankedMatch> ranked_matches(ConstArrayView<StringView> candidates, StringView query,
+                                   size_t min_chunk_size = 32 * 1024,
+                                   size_t worker_count = std::thread::hardware_concurrency());
+
+// Completion lists are cut to that many candidates, only the first ones
+// are ever looked at, refining the query brings the others up.
+constexpr size_t max_completion_candidates = 1000;
+
+// Sort the max_count best matches and drop the others, using a bounded heap
+// instead of sorting everything. Returns true if some matches were dropped.
+template<typename Container>
+bool keep_best_matches(Container& matches, size_t max_count = max_completion_candidates)
+{
+    if (matches.size() <= max_count)
+    {
+        std::sort(matches.begin(), matches.end());
+        return false;
+    }
+    std::partial_sort(matches.begin(), matches.begin() + max_count, matches.end());
+    matches.erase(matches.begin() + max_count, matches.end());
+    return true;
+}
+
 }
 
 #endif // ranked_match_hh_INCLUDED
@@ -1,16 +1,82 @@
 #include "regex.hh"
 
+#include "buffer_utils.hh"
 #include "exception.hh"
+#include "hash_map.hh"
+#include "unit_tests.hh"
+
+#include <algorithm>
 
 namespace Kakoune
 {
 
 using Utf8It = RegexUtf8It<const char*>;
 
+constexpr size_t regex_cache_size = 256;
+
+namespace
+{
+
+// Compiled regexes, shared by all the Regex built from the same pattern and
+// flags, as boost regexes share their compiled state when copied. The least
+// recently used one is dropped when the cache is full.
+struct RegexCache
+{
+    struct Entry
+    {
+        RegexBase regex;
+        size_t last_use;
+    };
+
+    HashMap<std::pair<String, RegexBase::flag_type>, Entry> entries;
+    size_t use_count = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    RegexBase get(StringView re, RegexBase::flag_type flags)
+    {
+        std::pair<String, RegexBase::flag_type> key{re.str(), flags};
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            ++hits;
+            it->value.last_use = ++use_count;
+            return it->value.regex;
+        }
+
+        ++misses;
+        RegexBase regex{Utf8It{re.begin(), re}, Utf8It{re.end(), re}, flags};
+        if (entries.size() >= regex_cache_size)
+        {
+            auto lru = std::min_element(entries.begin(), entries.end(),
+                                        [](auto& lhs, auto& rhs) { return lhs.value.last_use < rhs.value.last_use; });
+            entries.unordered_remove(lru->key);
+        }
+        entries.insert({std::move(key), {regex, ++use_count}});
+        return regex;
+    }
+};
+
+RegexCache& regex_cache()
+{
+    static RegexCache cache;
+    return cache;
+}
+
+}
+
 Regex::Regex(StringView re, flag_type flags) try
-    : RegexBase{Utf8It{re.begin(), re}, Utf8It{re.end(), re}, flags}, m_str{re.str()}
+    : RegexBase{regex_cache().get(re, flags)}, m_str{re.str()}
 {} catch (std::runtime_error& err) { throw regex_error(err.what()); }
 
+void regex_cache_debug_stats()
+{
+    auto& cache = regex_cache();
+    write_to_debug_buffer("Regex cache stats:");
+    write_to_debug_buffer(format("  entries: {}/{}", cache.entries.size(), regex_cache_size));
+    write_to_debug_buffer(format("  hits: {}, misses: {}", cache.hits, cache.misses));
+}
+
 String option_to_string(const Regex& re)
 {
     return re.str();
@@ -21,4 +87,25 @@ void option_from_string(StringView str, Regex& re)
     re = Regex{str};
 }
 
+UnitTest test_regex_cache{[]()
+{
+    auto& cache = regex_cache();
+    const size_t misses = cache.misses;
+
+    Regex a{"a(b|c)+d"};
+    Regex b{"a(b|c)+d"};
+    kak_assert(cache.misses == misses + 1);
+    kak_assert(&a.get_data() == &b.get_data());
+
+    Regex c{"a(b|c)+d", Regex::ECMAScript | Regex::icase};
+    kak_assert(cache.misses == misses + 2);
+    kak_assert(&c.get_data() != &a.get_data());
+
+    kak_assert(regex_match("abcbd", "abcbd" + 5, b));
+    bool failed = false;
+    try { Regex{"a(b"}; } catch (regex_error&) { failed = true; }
+    kak_assert(failed);
+    kak_assert(cache.misses == misses + 3);
+}};
+
 }
@@ -20,7 +20,8 @@ struct regex_error : runtime_error
 
 using RegexBase = boost::basic_regex<wchar_t, boost::c_regex_traits<wchar_t>>;
 
-// Regex that keeps track of its string representation
+// Regex that keeps track of its string representation, compiled regexes
+// are cached and shared between the Regex built from the same pattern
 class Regex : public RegexBase
 {
 public:
@@ -156,6 +157,9 @@ bool regex_search(It begin, It end, MatchResults<It>& res, const Regex& re,
     }
 }
 
+// Writes the compiled regex cache statistics to the debug buffer
+void regex_cache_debug_stats();
+
 String option_to_string(const Regex& re);
 void option_from_string(StringView str, Regex& re);
 
@@ -13,6 +13,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -29,6 +30,7 @@ enum class MessageType : uint8_t
     Connect,
     Command,
     MenuShow,
+    MenuItems,
     MenuSelect,
     MenuHide,
     InfoShow,
@@ -40,27 +42,107 @@ enum class MessageType : uint8_t
     SetOptions,
     Exit,
     Key,
+    MenuFetch,
+    ControlCommand,
+    ControlResult,
 };
 
+RemoteBuffer::Chunk& RemoteBuffer::writable_chunk(size_t min_size)
+{
+    if (m_chunks.empty() or chunk_size - m_chunks.back()->end < min_size)
+    {
+        // do not value initialize chunk data, only its end
+        m_chunks.push_back(m_spare ? std::move(m_spare) : std::unique_ptr<Chunk>(new Chunk));
+        m_chunks.back()->end = 0;
+    }
+    return *m_chunks.back();
+}
+
+void RemoteBuffer::write(const char* data, size_t size)
+{
+    m_size += size;
+    while (size != 0)
+    {
+        auto& chunk = writable_chunk(1);
+        const size_t len = std::min(size, chunk_size - chunk.end);
+        memcpy(chunk.data + chunk.end, data, len);
+        chunk.end += len;
+        data += len;
+        size -= len;
+    }
+}
+
+char* RemoteBuffer::write_contiguous(size_t size)
+{
+    kak_assert(size <= chunk_size);
+    auto& chunk = writable_chunk(size);
+    char* res = chunk.data + chunk.end;
+    chunk.end += size;
+    m_size += size;
+    return res;
+}
+
+size_t RemoteBuffer::send(int fd)
+{
+    constexpr size_t max_iov = 16;
+    iovec iov[max_iov];
+    size_t count = 0;
+    for (auto& chunk : m_chunks)
+    {
+        const size_t begin = count == 0 ? m_head : 0;
+        iov[count++] = { chunk->data + begin, chunk->end - begin };
+        if (count == max_iov)
+            break;
+    }
+
+    const ssize_t res = ::writev(fd, iov, (int)count);
+    if (res <= 0)
+        throw disconnected{format("socket write failed: {}", strerror(errno))};
+
+    m_size -= res;
+    size_t consumed = res;
+    while (consumed != 0)
+    {
+        auto& chunk = m_chunks.front();
+        if (consumed < chunk->end - m_head)
+        {
+            m_head += consumed;
+            break;
+        }
+        consumed -= chunk->end - m_head;
+        m_head = 0;
+        m_spare = std::move(chunk);
+        m_chunks.erase(m_chunks.begin());
+    }
+    return res;
+}
+
+// Faces already sent on a connection, each face is sent in full only the
+// first time, along with its id, and then only referenced through its id.
+using FaceIds = HashMap<Face, uint32_t, MemoryDomain::Remote>;
+
 class MsgWriter
 {
 public:
-    MsgWriter(RemoteBuffer& buffer, MessageType type)
-        : m_buffer{buffer}, m_start{(uint32_t)buffer.size()}
+    MsgWriter(RemoteBuffer& buffer, MessageType type, FaceIds* face_ids = nullptr)
+        : m_buffer{buffer}, m_start{buffer.size()}, m_face_ids{face_ids}
     {
-        write(type);
-        write((uint32_t)0); // message size, to be patched on write
+        // The header is kept contiguous so that the message size can be
+        // patched in place once known, as buffer content never moves.
+        char* header = m_buffer.write_contiguous(sizeof(MessageType) + sizeof(uint32_t));
+        memcpy(header, &type, sizeof(MessageType));
+        m_size = header + sizeof(MessageType);
     }
 
     ~MsgWriter() noexcept(false)
     {
-        uint32_t count = (uint32_t)m_buffer.size() - m_start;
-        memcpy(m_buffer.data() + m_start + sizeof(MessageType), &count, sizeof(uint32_t));
+        uint32_t count = (uint32_t)(m_buffer.size() - m_start);
+        memcpy(m_size, &count, sizeof(uint32_t));
     }
 
     void write(const char* val, size_t size)
     {
-        m_buffer.insert(m_buffer.end(), val, val + size);
+        m_buffer.write(val, size);
     }
 
     template<typename T>
@@ -124,6 +206,21 @@ public:
         }
     }
 
+    void write(const Face& face)
+    {
+        kak_assert(m_face_ids);
+        auto it = m_face_ids->find(face);
+        if (it != m_face_ids->end())
+            return write(it->value);
+
+        const uint32_t id = m_face_ids->size();
+        m_face_ids->insert({face, id});
+        write(id);
+        write(face.fg);
+        write(face.bg);
+        write(face.attributes);
+    }
+
     void write(const DisplayAtom& atom)
     {
         write(atom.content());
@@ -135,14 +232,35 @@ public:
         write(line.atoms());
     }
 
-    void write(const DisplayBuffer& display_buffer)
+    // Lines identical to the ones of the previous frame are sent as ranges
+    // of indices in it, other lines are sent in full.
+    void write(const DisplayBuffer& display_buffer, LineDamageTracker& tracker)
     {
-        write(display_buffer.lines());
+        auto& lines = display_buffer.lines();
+        auto matches = tracker.update(lines);
+        write<uint32_t>(lines.size());
+        for (size_t i = 0; i < lines.size(); )
+        {
+            const int first = matches[i];
+            write<int32_t>(first);
+            if (first == -1)
+            {
+                write(lines[i++]);
+                continue;
+            }
+            uint32_t count = 1;
+            while (i + count < lines.size() and matches[i + count] == first + count)
+                ++count;
+            write(count);
+            i += count;
+        }
     }
 
 private:
     RemoteBuffer& m_buffer;
-    uint32_t m_start;
+    size_t m_start;
+    char* m_size;
+    FaceIds* m_face_ids;
 };
 
 class MsgReader
@@ -261,6 +379,7 @@ private:
     Vector<char, MemoryDomain::Remote> m_stream;
     uint32_t m_write_pos = 0;
     uint32_t m_read_pos = header_size;
+    Vector<Face, MemoryDomain::Remote> m_faces; // indexed by id, see FaceIds
 };
 
 template<>
@@ -290,6 +409,23 @@ Color MsgReader::read<Color>()
     return res;
 }
 
+template<>
+Face MsgReader::read<Face>()
+{
+    const uint32_t id = read<uint32_t>();
+    if (id < m_faces.size())
+        return m_faces[id];
+    if (id != m_faces.size())
+        throw disconnected{"invalid face id received"};
+
+    Face face;
+    face.fg = read<Color>();
+    face.bg = read<Color>();
+    face.attributes = read<Attribute>();
+    m_faces.push_back(face);
+    return face;
+}
+
 template<>
 DisplayAtom MsgReader::read<DisplayAtom>()
 {
@@ -304,12 +440,29 @@ DisplayLine MsgReader::read<DisplayLine>()
     return DisplayLine(read_vector<DisplayAtom>());
 }
 
-template<>
-DisplayBuffer MsgReader::read<DisplayBuffer>()
+// Read a display buffer sent by MsgWriter::write(const DisplayBuffer&, LineDamageTracker&),
+// previous is the last frame read, and is updated to the new one.
+static void read_display_buffer(MsgReader& reader, DisplayBuffer& previous)
 {
-    DisplayBuffer db;
-    db.lines() = read_vector<DisplayLine>();
-    return db;
+    DisplayBuffer::LineList lines;
+    uint32_t count = reader.read<uint32_t>();
+    lines.reserve(count);
+    while (lines.size() < count)
+    {
+        const int32_t first = reader.read<int32_t>();
+        if (first == -1)
+        {
+            lines.push_back(reader.read<DisplayLine>());
+            continue;
+        }
+
+        const uint32_t length = reader.read<uint32_t>();
+        if (first < 0 or first + length > previous.lines().size() or
+            lines.size() + length > count)
+            throw disconnected{"invalid display line range received"};
+        std::copy_n(previous.lines().begin() + first, length, std::back_inserter(lines));
+    }
+    previous.lines() = std::move(lines);
 }
 
 
@@ -319,9 +472,10 @@ public:
     RemoteUI(int socket, DisplayCoord dimensions);
     ~RemoteUI() override;
 
-    void menu_show(ConstArrayView<DisplayLine> choices,
-                   DisplayCoord anchor, Face fg, Face bg,
+    void menu_show(ConstArrayView<DisplayLine> choices, int item_count,
+                   ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
                    MenuStyle style) override;
+    void menu_items(int first, ConstArrayView<DisplayLine> choices) override;
     void menu_select(int selected) override;
     void menu_hide() override;
 
@@ -344,8 +498,8 @@ public:
 
     DisplayCoord dimensions() override { return m_dimensions; }
 
-    void set_on_key(OnKeyCallback callback) override
-    { m_on_key = std::move(callback); }
+    void set_on_key(OnKeyCallback callback) override;
+    void set_on_menu_fetch(OnMenuFetchCallback callback) override;
 
     void set_ui_options(const Options& options) override;
 
@@ -359,7 +513,11 @@ private:
     MsgReader     m_reader;
     DisplayCoord  m_dimensions;
     OnKeyCallback m_on_key;
+    OnMenuFetchCallback m_on_menu_fetch;
+    Vector<Key, MemoryDomain::Remote> m_pending_keys;
     RemoteBuffer  m_send_buffer;
+    LineDamageTracker m_draw_tracker;
+    FaceIds       m_face_ids;
 
     SafePtr<Client> m_client;
 };
@@ -367,12 +525,7 @@ private:
 static bool send_data(int fd, RemoteBuffer& buffer)
 {
     while (not buffer.empty() and fd_writable(fd))
-    {
-      int res = ::write(fd, buffer.data(), buffer.size());
-      if (res <= 0)
-          throw disconnected{format("socket write failed: {}", strerror(errno))};
-      buffer.erase(buffer.begin(), buffer.begin() + res);
-    }
+        buffer.send(fd);
     return buffer.empty();
 }
 
@@ -383,7 +536,7 @@ RemoteUI::RemoteUI(int socket, DisplayCoord dimensions)
           try
           {
               if (events & FdEvents::Write and send_data(sock, m_send_buffer))
-                  m_socket_watcher.events() &= ~FdEvents::Write;
+                  m_socket_watcher.set_events(m_socket_watcher.events() & ~FdEvents::Write);
 
               while (events & FdEvents::Read and fd_readable(sock))
               {
@@ -392,6 +545,16 @@ RemoteUI::RemoteUI(int socket, DisplayCoord dimensions)
                   if (not m_reader.ready())
                       continue;
 
+                   if (m_reader.type() == MessageType::MenuFetch)
+                   {
+                       const int first = m_reader.read<int>();
+                       const int count = m_reader.read<int>();
+                       m_reader.reset();
+                       if (m_on_menu_fetch)
+                           m_on_menu_fetch(first, count);
+                       continue;
+                   }
+
                    if (m_reader.type() != MessageType::Key)
                    {
                       ClientManager::instance().remove_client(*m_client, false, -1);
@@ -402,7 +565,10 @@ RemoteUI::RemoteUI(int socket, DisplayCoord dimensions)
                    m_reader.reset();
                    if (key.modifiers == Key::Modifiers::Resize)
                        m_dimensions = key.coord();
-                   m_on_key(key);
+                   if (m_on_key)
+                       m_on_key(key);
+                   else // the client is still being created
+                       m_pending_keys.push_back(key);
               }
           }
           catch (const disconnected& err)
@@ -431,71 +597,94 @@ RemoteUI::~RemoteUI()
     m_socket_watcher.close_fd();
 }
 
-void RemoteUI::menu_show(ConstArrayView<DisplayLine> choices,
-                         DisplayCoord anchor, Face fg, Face bg,
+void RemoteUI::set_on_key(OnKeyCallback callback)
+{
+    m_on_key = std::move(callback);
+    for (auto& key : m_pending_keys)
+        m_on_key(key);
+    m_pending_keys.clear();
+}
+
+void RemoteUI::set_on_menu_fetch(OnMenuFetchCallback callback)
+{
+    m_on_menu_fetch = std::move(callback);
+}
+
+void RemoteUI::menu_show(ConstArrayView<DisplayLine> choices, int item_count,
+                         ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
                          MenuStyle style)
 {
-    MsgWriter msg{m_send_buffer, MessageType::MenuShow};
+    MsgWriter msg{m_send_buffer, MessageType::MenuShow, &m_face_ids};
     msg.write(choices);
+    msg.write(item_count);
+    msg.write(longest);
     msg.write(anchor);
     msg.write(fg);
     msg.write(bg);
     msg.write(style);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
+}
+
+void RemoteUI::menu_items(int first, ConstArrayView<DisplayLine> choices)
+{
+    MsgWriter msg{m_send_buffer, MessageType::MenuItems, &m_face_ids};
+    msg.write(first);
+    msg.write(choices);
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::menu_select(int selected)
 {
     MsgWriter msg{m_send_buffer, MessageType::MenuSelect};
     msg.write(selected);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::menu_hide()
 {
     MsgWriter msg{m_send_buffer, MessageType::MenuHide};
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::info_show(StringView title, StringView content,
                          DisplayCoord anchor, Face face,
                          InfoStyle style)
 {
-    MsgWriter msg{m_send_buffer, MessageType::InfoShow};
+    MsgWriter msg{m_send_buffer, MessageType::InfoShow, &m_face_ids};
     msg.write(title);
     msg.write(content);
     msg.write(anchor);
     msg.write(face);
     msg.write(style);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::info_hide()
 {
     MsgWriter msg{m_send_buffer, MessageType::InfoHide};
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::draw(const DisplayBuffer& display_buffer,
                     const Face& default_face,
                     const Face& padding_face)
 {
-    MsgWriter msg{m_send_buffer, MessageType::Draw};
-    msg.write(display_buffer);
+    MsgWriter msg{m_send_buffer, MessageType::Draw, &m_face_ids};
+    msg.write(display_buffer, m_draw_tracker);
     msg.write(default_face);
     msg.write(padding_face);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::draw_status(const DisplayLine& status_line,
                            const DisplayLine& mode_line,
                            const Face& default_face)
 {
-    MsgWriter msg{m_send_buffer, MessageType::DrawStatus};
+    MsgWriter msg{m_send_buffer, MessageType::DrawStatus, &m_face_ids};
     msg.write(status_line);
     msg.write(mode_line);
     msg.write(default_face);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::set_cursor(CursorMode mode, DisplayCoord coord)
@@ -503,28 +692,28 @@ void RemoteUI::set_cursor(CursorMode mode, DisplayCoord coord)
     MsgWriter msg{m_send_buffer, MessageType::SetCursor};
     msg.write(mode);
     msg.write(coord);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::refresh(bool force)
 {
     MsgWriter msg{m_send_buffer, MessageType::Refresh};
     msg.write(force);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::set_ui_options(const Options& options)
 {
     MsgWriter msg{m_send_buffer, MessageType::SetOptions};
     msg.write(options);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 void RemoteUI::exit(int status)
 {
     MsgWriter msg{m_send_buffer, MessageType::Exit};
     msg.write(status);
-    m_socket_watcher.events() |= FdEvents::Write;
+    m_socket_watcher.set_events(m_socket_watcher.events() | FdEvents::Write);
 }
 
 static sockaddr_un session_addr(StringView session)
@@ -576,15 +765,23 @@ RemoteClient::RemoteClient(StringView session, std::unique_ptr<UserInterface>&&
     m_ui->set_on_key([this](Key key){
         MsgWriter msg(m_send_buffer, MessageType::Key);
         msg.write(key);
-        m_socket_watcher->events() |= FdEvents::Write;
+        m_socket_watcher->set_events(m_socket_watcher->events() | FdEvents::Write);
      });
 
+    m_ui->set_on_menu_fetch([this](int first, int count){
+        MsgWriter msg(m_send_buffer, MessageType::MenuFetch);
+        msg.write(first);
+        msg.write(count);
+        m_socket_watcher->set_events(m_socket_watcher->events() | FdEvents::Write);
+    });
+
     MsgReader reader;
+    DisplayBuffer display_buffer;
     m_socket_watcher.reset(new FDWatcher{sock, FdEvents::Read | FdEvents::Write,
-                           [this, reader](FDWatcher& watcher, FdEvents events, EventMode) mutable {
+                           [this, reader, display_buffer](FDWatcher& watcher, FdEvents events, EventMode) mutable {
         const int sock = watcher.fd();
         if (events & FdEvents::Write and send_data(sock, m_send_buffer))
-            m_socket_watcher->events() &= ~FdEvents::Write;
+            m_socket_watcher->set_events(m_socket_watcher->events() & ~FdEvents::Write);
 
         while (events & FdEvents::Read and
                not reader.ready() and fd_readable(sock))
@@ -600,11 +797,22 @@ RemoteClient::RemoteClient(StringView session, std::unique_ptr<UserInterface>&&
             case MessageType::MenuShow:
             {
                 auto choices = reader.read_vector<DisplayLine>();
+                auto item_count = reader.read<int>();
+                auto longest = reader.read<ColumnCount>();
                 auto anchor = reader.read<DisplayCoord>();
                 auto fg = reader.read<Face>();
                 auto bg = reader.read<Face>();
                 auto style = reader.read<MenuStyle>();
-                m_ui->menu_show(choices, anchor, fg, bg, style);
+                m_ui->menu_show(choices, item_count, longest, anchor, fg, bg, style);
+                break;
+            }
+            case MessageType::MenuItems:
+            {
+                auto first = reader.read<int>();
+                auto choices = reader.read_vector<DisplayLine>();
+                m_ui->menu_items(first, choices);
+                // fetched items arrive after the refresh of the menu showing them
+                m_ui->refresh(false);
                 break;
             }
             case MessageType::MenuSelect:
@@ -628,7 +836,7 @@ RemoteClient::RemoteClient(StringView session, std::unique_ptr<UserInterface>&&
                 break;
             case MessageType::Draw:
             {
-                auto display_buffer = reader.read<DisplayBuffer>();
+                read_display_buffer(reader, display_buffer);
                 auto default_face = reader.read<Face>();
                 auto padding_face = reader.read<Face>();
                 m_ui->draw(display_buffer, default_face, padding_face);
@@ -657,9 +865,10 @@ RemoteClient::RemoteClient(StringView session, std::unique_ptr<UserInterface>&&
                 break;
             case MessageType::Exit:
                 m_exit_status = reader.read<int>();
+                // Do not reset the watcher here, that would destroy this lambda
+                // and the reader it owns while they are still in use.
                 m_socket_watcher->close_fd();
-                m_socket_watcher.reset();
-                return; // This lambda is now dead
+                return;
             default:
                 kak_assert(false);
             }
@@ -676,9 +885,112 @@ void send_command(StringView session, StringView command)
         MsgWriter msg{buffer, MessageType::Command};
         msg.write(command);
     }
-    write(sock, {buffer.data(), buffer.data() + buffer.size()});
+    while (not buffer.empty())
+        buffer.send(sock);
+}
+
+
+static String escape_control(StringView str)
+{
+    String res;
+    res.reserve(str.length());
+    for (auto c : str)
+    {
+        if (c == '\n')
+            res += "\\n";
+        else if (c == '\\')
+            res += "\\\\";
+        else
+            res += c;
+    }
+    return res;
+}
+
+static String unescape_control(StringView str)
+{
+    String res;
+    res.reserve(str.length());
+    for (auto it = str.begin(), end = str.end(); it != end; ++it)
+    {
+        if (*it == '\\' and it+1 != end and (*(it+1) == 'n' or *(it+1) == '\\'))
+            res += *++it == 'n' ? '\n' : '\\';
+        else
+            res += *it;
+    }
+    return res;
+}
+
+RemoteControl::RemoteControl(StringView session, int in_fd, int out_fd)
+    : m_out_fd{out_fd}
+{
+    int sock = connect_to(session);
+
+    MsgReader reader;
+    m_socket_watcher.reset(new FDWatcher{sock, FdEvents::Read,
+                           [this, reader](FDWatcher& watcher, FdEvents events, EventMode) mutable {
+        const int sock = watcher.fd();
+        if (events & FdEvents::Write and send_data(sock, m_send_buffer))
+            m_socket_watcher->set_events(FdEvents::Read);
+
+        while (events & FdEvents::Read and fd_readable(sock))
+        {
+            reader.read_available(sock);
+            if (not reader.ready())
+                continue;
+
+            auto clear_reader = on_scope_end([&reader] { reader.reset(); });
+            if (reader.type() != MessageType::ControlResult)
+                throw disconnected{"unexpected message received"};
+
+            auto id = reader.read<String>();
+            auto success = reader.read<bool>();
+            auto output = reader.read<String>();
+            write(m_out_fd, format("{}\t{}\t{}\n", id, success ? "ok" : "error",
+                                   escape_control(output)));
+            --m_pending;
+        }
+    }});
+
+    m_input_watcher.reset(new FDWatcher{in_fd, FdEvents::Read,
+                          [this](FDWatcher& watcher, FdEvents, EventMode) {
+        char buf[4096];
+        ssize_t size = ::read(watcher.fd(), buf, sizeof(buf));
+        if (size > 0)
+            m_input += StringView{buf, buf + size};
+        else if (size == 0 or errno != EINTR)
+        {
+            // an unterminated last line is still a request
+            if (not m_input.empty() and m_input.back() != '\n')
+                m_input += '\n';
+            m_input_closed = true;
+            watcher.disable();
+        }
+        send_requests();
+    }});
 }
 
+void RemoteControl::send_requests()
+{
+    auto pos = m_input.begin();
+    for (auto eol = std::find(pos, m_input.end(), '\n'); eol != m_input.end();
+         pos = eol+1, eol = std::find(pos, m_input.end(), '\n'))
+    {
+        StringView line{pos, eol};
+        auto tab = std::find(line.begin(), line.end(), '\t');
+        StringView id = tab != line.end() ? StringView{line.begin(), tab} : StringView{};
+        StringView command = tab != line.end() ? StringView{tab+1, line.end()} : line;
+
+        MsgWriter msg{m_send_buffer, MessageType::ControlCommand};
+        msg.write(id);
+        msg.write(unescape_control(command));
+        ++m_pending;
+    }
+    if (pos == m_input.begin())
+        return;
+
+    m_input = String{pos, m_input.end()};
+    m_socket_watcher->set_events(FdEvents::Read | FdEvents::Write);
+}
 
 // A client accepter handle a connection until it closes or a nul byte is
 // recieved. Everything recieved before is considered to be a command.
@@ -686,81 +998,126 @@ void send_command(StringView session, StringView command)
 // * When a nul byte is recieved, the socket is handed to a new Client along
 //   with the command.
 // * When the connection is closed, the command is run in an empty context.
+// * When a control command is recieved, the connection is kept open to
+//   run every following control command, replying to each one with its
+//   success and its output (or error message).
 class Server::Accepter
 {
 public:
     Accepter(int socket)
         : m_socket_watcher(socket, FdEvents::Read,
-                           [this](FDWatcher&, FdEvents, EventMode mode) {
+                           [this](FDWatcher&, FdEvents events, EventMode mode) {
                                if (mode == EventMode::Normal)
-                                   handle_available_input();
+                                   handle_available_input(events);
                            })
     {}
 
 private:
-    void handle_available_input()
+    void handle_available_input(FdEvents events)
     {
         const int sock = m_socket_watcher.fd();
         try
         {
-            while (not m_reader.ready() and fd_readable(sock))
-                m_reader.read_available(sock);
-
-            if (not m_reader.ready())
-                return;
+            if (events & FdEvents::Write and send_data(sock, m_send_buffer))
+                m_socket_watcher.set_events(FdEvents::Read);
 
-            switch (m_reader.type())
-            {
-            case MessageType::Connect:
+            while (fd_readable(sock))
             {
-                auto pid = m_reader.read<int>();
-                auto init_cmds = m_reader.read<String>();
-                auto init_coord = m_reader.read_optional<BufferCoord>();
-                auto dimensions = m_reader.read<DisplayCoord>();
-                auto env_vars = m_reader.read_hash_map<String, String, MemoryDomain::EnvVars>();
-                auto* ui = new RemoteUI{sock, dimensions};
-                if (auto* client = ClientManager::instance().create_client(
-                                       std::unique_ptr<UserInterface>(ui), pid,
-                                       std::move(env_vars), init_cmds, init_coord,
-                                       [ui](int status) { ui->exit(status); }))
-                    ui->set_client(client);
-
-                Server::instance().remove_accepter(this);
-                break;
-            }
-            case MessageType::Command:
-            {
-                auto command = m_reader.read<String>();
-                if (not command.empty()) try
+                m_reader.read_available(sock);
+                if (not m_reader.ready())
+                    continue;
+
+                switch (m_reader.type())
+                {
+                case MessageType::Connect:
                 {
-                    Context context{Context::EmptyContextFlag{}};
-                    CommandManager::instance().execute(command, context);
+                    auto pid = m_reader.read<int>();
+                    auto init_cmds = m_reader.read<String>();
+                    auto init_coord = m_reader.read_optional<BufferCoord>();
+                    auto dimensions = m_reader.read<DisplayCoord>();
+                    auto env_vars = m_reader.read_hash_map<String, String, MemoryDomain::EnvVars>();
+                    auto* ui = new RemoteUI{sock, dimensions};
+                    if (auto* client = ClientManager::instance().create_client(
+                                           std::unique_ptr<UserInterface>(ui), pid,
+                                           std::move(env_vars), init_cmds, init_coord,
+                                           [ui](int status) { ui->exit(status); }))
+                        ui->set_client(client);
+
+                    Server::instance().remove_accepter(this);
+                    return;
                 }
-                catch (const runtime_error& e)
+                case MessageType::Command:
                 {
-                    write_to_debug_buffer(format("error running command '{}': {}",
-                                                 command, e.what()));
+                    auto command = m_reader.read<String>();
+                    if (not command.empty()) try
+                    {
+                        Context context{Context::EmptyContextFlag{}};
+                        CommandManager::instance().execute(command, context);
+                    }
+                    catch (const runtime_error& e)
+                    {
+                        write_to_debug_buffer(format("error running command '{}': {}",
+                                                     command, e.what()));
+                    }
+                    close(sock);
+                    Server::instance().remove_accepter(this);
+                    return;
+                }
+                case MessageType::ControlCommand:
+                    m_control = true;
+                    run_control_command();
+                    m_reader.reset();
+                    break;
+                default:
+                    write_to_debug_buffer("Invalid introduction message received");
+                    close(sock);
+                    Server::instance().remove_accepter(this);
+                    return;
                 }
-                close(sock);
-                Server::instance().remove_accepter(this);
-                break;
-            }
-            default:
-                write_to_debug_buffer("Invalid introduction message received");
-                close(sock);
-                Server::instance().remove_accepter(this);
             }
+
+            if (m_control and not send_data(sock, m_send_buffer))
+                m_socket_watcher.set_events(FdEvents::Read | FdEvents::Write);
         }
         catch (const disconnected& err)
         {
-            write_to_debug_buffer(format("accepting connection failed: {}", err.what()));
+            // control connections are closed by the client once done
+            if (not m_control)
+                write_to_debug_buffer(format("accepting connection failed: {}", err.what()));
             close(sock);
             Server::instance().remove_accepter(this);
         }
     }
 
+    void run_control_command()
+    {
+        auto id = m_reader.read<String>();
+        auto command = m_reader.read<String>();
+
+        String output;
+        bool success = true;
+        try
+        {
+            Context context{Context::EmptyContextFlag{}};
+            context.set_status_output(&output);
+            CommandManager::instance().execute(command, context);
+        }
+        catch (const runtime_error& e)
+        {
+            success = false;
+            output = e.what().str();
+        }
+
+        MsgWriter msg{m_send_buffer, MessageType::ControlResult};
+        msg.write(id);
+        msg.write(success);
+        msg.write(output);
+    }
+
     FDWatcher m_socket_watcher;
     MsgReader m_reader;
+    RemoteBuffer m_send_buffer;
+    bool m_control = false;
 };
 
 Server::Server(String session_name)
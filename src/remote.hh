@@ -23,7 +23,43 @@ class UserInterface;
 template<typename T> struct Optional;
 struct BufferCoord;
 
-using RemoteBuffer = Vector<char, MemoryDomain::Remote>;
+// Outgoing data for a remote connection, stored as a queue of fixed size
+// chunks used as a ring: appending never moves existing data, consumed
+// chunks get recycled, and pending data is sent with a single writev.
+class RemoteBuffer
+{
+public:
+    RemoteBuffer() = default;
+    RemoteBuffer(RemoteBuffer&&) = default;
+    RemoteBuffer& operator=(RemoteBuffer&&) = default;
+
+    bool   empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+
+    void write(const char* data, size_t size);
+    // returns size contiguous bytes at the end of the buffer, size must not
+    // be greater than a chunk, the content is to be filled by the caller.
+    char* write_contiguous(size_t size);
+
+    // write as much pending data as possible in one call, returns the
+    // number of bytes written, or throws disconnected on error.
+    size_t send(int fd);
+
+private:
+    static constexpr size_t chunk_size = 32 * 1024;
+    struct Chunk
+    {
+        size_t end = 0;
+        char data[chunk_size];
+    };
+
+    Chunk& writable_chunk(size_t min_size);
+
+    Vector<std::unique_ptr<Chunk>, MemoryDomain::Remote> m_chunks;
+    std::unique_ptr<Chunk> m_spare;
+    size_t m_head = 0; // read offset in first chunk
+    size_t m_size = 0;
+};
 
 // A remote client handle communication between a client running on the server
 // and a user interface running on the local process.
@@ -44,6 +80,31 @@ private:
 
 void send_command(StringView session, StringView command);
 
+// A remote control forwards the requests read from in_fd to a session through
+// a single persistent connection, and writes the result of each of them to
+// out_fd as soon as it is received.
+//
+// Requests are lines of the form "<id>\t<command>", results are lines of the
+// form "<id>\t<ok|error>\t<output>", where newlines and antislashes in command
+// and output are escaped as \n and \\.
+class RemoteControl
+{
+public:
+    RemoteControl(StringView session, int in_fd, int out_fd);
+
+    bool finished() const { return m_input_closed and m_pending == 0; }
+private:
+    void send_requests();
+
+    std::unique_ptr<FDWatcher> m_socket_watcher;
+    std::unique_ptr<FDWatcher> m_input_watcher;
+    RemoteBuffer               m_send_buffer;
+    String                     m_input;
+    int                        m_out_fd;
+    int                        m_pending = 0;
+    bool                       m_input_closed = false;
+};
+
 struct Server : public Singleton<Server>
 {
     Server(String session_name);
@@ -38,7 +38,7 @@ Selection utf8_range(const Utf8Iterator& first, const Utf8Iterator& last)
 
 ConstArrayView<Codepoint> get_extra_word_chars(const Context& context)
 {
-    return context.options()["extra_word_chars"].get<Vector<Codepoint, MemoryDomain::Options>>();
+    return context.options().get(extra_word_chars_option);
 }
 
 }
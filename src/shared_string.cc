@@ -1,5 +1,6 @@
 #include "shared_string.hh"
 #include "buffer_utils.hh"
+#include "hash.hh"
 
 #include <cstring>
 
@@ -20,6 +21,7 @@ StringDataPtr StringData::create(ArrayView<const StringView> strs)
         data += (int)str.length();
     }
     *data = 0;
+    res->hash = (uint32_t)hash_data(res->data(), len);
     return RefPtr<StringData, PtrPolicy>{res};
 }
 
@@ -15,6 +15,7 @@ struct StringData : UseMemoryDomain<MemoryDomain::SharedString>
 {
     uint32_t refcount;
     const int length;
+    uint32_t hash; // hash_data of the content, computed on creation
 
     [[gnu::always_inline]]
     const char* data() const { return reinterpret_cast<const char*>(this + 1); }
@@ -22,7 +23,7 @@ struct StringData : UseMemoryDomain<MemoryDomain::SharedString>
     StringView strview() const { return {data(), length}; }
 
 private:
-    StringData(int len) : refcount(0), length(len) {}
+    StringData(int len) : refcount(0), length(len), hash(0) {}
 
     static constexpr uint32_t interned_flag = 1 << 31;
     static constexpr uint32_t refcount_mask = ~interned_flag;
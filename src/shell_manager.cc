@@ -7,6 +7,7 @@
 #include "event_manager.hh"
 #include "face_registry.hh"
 #include "file.hh"
+#include "file_watcher.hh"
 #include "flags.hh"
 #include "option.hh"
 #include "regex.hh"
@@ -150,7 +151,7 @@ std::pair<String, int> ShellManager::eval(
     StringView cmdline, const Context& context, StringView input,
     Flags flags, const ShellContext& shell_context)
 {
-    const DebugFlags debug_flags = context.options()["debug"].get<DebugFlags>();
+    const DebugFlags debug_flags = context.options().get(debug_option);
     const bool profile = debug_flags & DebugFlags::Profile;
     if (debug_flags & DebugFlags::Shell)
         write_to_debug_buffer(format("shell:\n{}\n----\n", cmdline));
@@ -274,6 +275,11 @@ std::pair<String, int> ShellManager::eval(
             terminated = waitpid(pid, &status, WNOHANG) != 0;
     }
 
+    // The command may have written watched files, and the client can check
+    // its buffer before the event loop reads the file watcher events
+    if (FileWatcher::has_instance())
+        FileWatcher::instance().read_events();
+
     if (not stderr_contents.empty())
         write_to_debug_buffer(format("shell stderr: <<<\n{}>>>", stderr_contents));
 
@@ -0,0 +1,1098 @@
+#include "terminal_ui.hh"
+
+#include "display_buffer.hh"
+#include "event_manager.hh"
+#include "file.hh"
+#include "hash_map.hh"
+#include "keys.hh"
+#include "ranges.hh"
+#include "string_utils.hh"
+#include "utf8.hh"
+
+#include <algorithm>
+
+#include <csignal>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace Kakoune
+{
+
+using std::min;
+using std::max;
+
+template<typename T> T sq(T x) { return x * x; }
+
+template<typename T>
+T div_round_up(T a, T b)
+{
+    return (a - T(1)) / b + T(1);
+}
+
+static sig_atomic_t terminal_resize_pending = 0;
+
+static void on_terminal_resize(int)
+{
+    terminal_resize_pending = 1;
+    EventManager::instance().force_signal(0);
+}
+
+// Used by abort to restore the terminal from a signal handler
+static bool terminal_modified = false;
+static termios terminal_original_termios;
+
+static constexpr char terminal_reset[] =
+    "\033[?1004l\033[?1006l\033[?1002l\033[0m\033[?7h\033[?25h\033[?1049l";
+
+// Never equal to a cell, forces it to be emitted
+static constexpr Codepoint invalid_codepoint = (Codepoint)-1;
+
+// how long to wait for the end of an escape sequence split between reads
+// before reading its escape as a key on its own, same as ncurses escdelay
+constexpr auto escape_delay = std::chrono::milliseconds{25};
+
+void TerminalUI::Grid::resize(DisplayCoord new_size, const Cell& cell)
+{
+    size = new_size;
+    cells.assign((size_t)(int)size.line * (int)size.column, cell);
+}
+
+ColumnCount TerminalUI::Grid::draw(LineCount line, ColumnCount column, StringView content,
+                                   ColumnCount max_column, const Face& face)
+{
+    Cell* cells = this->line(line);
+    max_column = min(max_column, size.column);
+    for (auto it = content.begin(), end = content.end(); it != end; )
+    {
+        Codepoint cp = utf8::read_codepoint(it, end);
+        if (cp == '\n')
+            cp = ' ';
+        else if (cp < 0x20 or cp == 0x7f)
+            cp = '?';
+
+        const ColumnCount width = codepoint_width(cp);
+        if (width == 0)
+            continue;
+        if (column + width > max_column)
+            break;
+
+        cells[(int)column] = Cell{cp, face};
+        if (width == 2)
+            cells[(int)column + 1] = Cell{0, face};
+        column += width;
+    }
+    return column;
+}
+
+ColumnCount TerminalUI::Grid::draw(LineCount line, ColumnCount column, const DisplayLine& content,
+                                   ColumnCount max_column, const Face& default_face)
+{
+    for (const DisplayAtom& atom : content)
+    {
+        Face face = atom.face;
+        if (face.fg == Color::Default)
+            face.fg = default_face.fg;
+        if (face.bg == Color::Default)
+            face.bg = default_face.bg;
+
+        column = draw(line, column, atom.content(), max_column, face);
+    }
+    return column;
+}
+
+void TerminalUI::Grid::fill(LineCount line, ColumnCount column, ColumnCount end, const Face& face)
+{
+    std::fill(this->line(line) + (int)column, this->line(line) + (int)min(end, size.column),
+              Cell{' ', face});
+}
+
+void TerminalUI::Window::create(const DisplayCoord& p, const DisplayCoord& s, const Face& face)
+{
+    pos = p;
+    size = s;
+    grid.resize(size, Cell{' ', face});
+}
+
+void TerminalUI::Window::destroy()
+{
+    grid = Grid{};
+    pos = DisplayCoord{};
+    size = DisplayCoord{};
+}
+
+TerminalUI::TerminalUI()
+    : m_stdin_watcher{0, FdEvents::Read,
+                      [this](FDWatcher&, FdEvents, EventMode mode) {
+        if (not m_on_key)
+            return;
+
+        while (auto key = get_next_key())
+            m_on_key(*key);
+      }},
+      m_escape_timer{TimePoint::max(), [this](Timer&) {
+        m_escape_timed_out = true;
+        if (not m_on_key)
+            return;
+
+        while (auto key = get_next_key())
+            m_on_key(*key);
+      }},
+      m_assistant(*find_assistant("clippy")),
+      m_cursor{CursorMode::Buffer, {}}
+{
+    tcgetattr(0, &m_original_termios);
+    setup_terminal();
+
+    set_signal_handler(SIGWINCH, on_terminal_resize);
+    set_signal_handler(SIGCONT, on_terminal_resize);
+
+    enable_mouse(true);
+    check_resize(true);
+}
+
+TerminalUI::~TerminalUI()
+{
+    enable_mouse(false);
+    restore_terminal();
+    set_signal_handler(SIGWINCH, SIG_DFL);
+    set_signal_handler(SIGCONT, SIG_DFL);
+}
+
+void TerminalUI::setup_terminal()
+{
+    termios attr = m_original_termios;
+    attr.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+    attr.c_oflag &= ~OPOST;
+    attr.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    attr.c_cflag &= ~(CSIZE | PARENB);
+    attr.c_cflag |= CS8;
+    attr.c_cc[VMIN] = 1;
+    attr.c_cc[VTIME] = 0;
+    tcsetattr(0, TCSADRAIN, &attr);
+
+    // alternate screen, no autowrap, hidden cursor, focus events
+    write(1, "\033[?1049h\033[?7l\033[?25l\033[?1004h");
+    if (m_mouse_enabled)
+        write(1, "\033[?1002h\033[?1006h");
+
+    terminal_original_termios = m_original_termios;
+    terminal_modified = true;
+    m_terminal_setup = true;
+
+    // the terminal state is unknown, repaint everything
+    m_front.resize(m_front.size, Cell{invalid_codepoint, {}});
+    m_output_cursor = {-1, -1};
+    m_output_face.reset();
+    m_title_changed = true;
+}
+
+void TerminalUI::restore_terminal()
+{
+    if (not m_terminal_setup)
+        return;
+
+    write(1, terminal_reset);
+    tcsetattr(0, TCSADRAIN, &m_original_termios);
+    terminal_modified = false;
+    m_terminal_setup = false;
+}
+
+void TerminalUI::abort()
+{
+    if (not terminal_modified)
+        return;
+
+    ::write(1, terminal_reset, sizeof(terminal_reset) - 1);
+    tcsetattr(0, TCSADRAIN, &terminal_original_termios);
+}
+
+void TerminalUI::on_sighup()
+{
+    set_signal_handler(SIGWINCH, SIG_DFL);
+    set_signal_handler(SIGCONT, SIG_DFL);
+
+    // the terminal is gone, do not try to use it anymore
+    m_terminal_setup = false;
+    terminal_modified = false;
+}
+
+void TerminalUI::check_resize(bool force)
+{
+    if (not force and not terminal_resize_pending)
+        return;
+
+    terminal_resize_pending = 0;
+
+    winsize ws;
+    if (ioctl(1, TIOCGWINSZ, (void*)&ws) != 0 or ws.ws_row == 0 or ws.ws_col == 0)
+    {
+        ws.ws_row = 24;
+        ws.ws_col = 80;
+    }
+
+    const bool info = (bool)m_info;
+    const bool menu = (bool)m_menu;
+    if (info) m_info.destroy();
+    if (menu) m_menu.destroy();
+
+    m_dimensions = DisplayCoord{ws.ws_row-1, ws.ws_col};
+    m_screen.resize({ws.ws_row, ws.ws_col}, Cell{});
+    m_front.resize({ws.ws_row, ws.ws_col}, Cell{invalid_codepoint, {}});
+    m_output_cursor = {-1, -1};
+
+    if (menu)
+        create_menu();
+    if (info)
+        info_show(m_info.title, m_info.content, m_info.anchor, m_info.face, m_info.style);
+
+    m_resize_key_pending = true;
+    m_dirty = true;
+}
+
+void TerminalUI::draw(const DisplayBuffer& display_buffer,
+                      const Face& default_face,
+                      const Face& padding_face)
+{
+    check_resize();
+
+    const Face blank_face{default_face.fg, default_face.bg};
+    LineCount line_index = m_status_on_top ? 1 : 0;
+    for (const DisplayLine& line : display_buffer.lines())
+    {
+        m_screen.fill(line_index, 0, m_dimensions.column, blank_face);
+        m_screen.draw(line_index, 0, line, m_dimensions.column, default_face);
+        ++line_index;
+    }
+
+    Face tilde_face = padding_face;
+    if (tilde_face.fg == Color::Default)
+        tilde_face.fg = default_face.fg;
+    if (tilde_face.bg == Color::Default)
+        tilde_face.bg = default_face.bg;
+
+    while (line_index < m_dimensions.line + (m_status_on_top ? 1 : 0))
+    {
+        m_screen.fill(line_index, 0, m_dimensions.column, {padding_face.fg, padding_face.bg});
+        m_screen.draw(line_index++, 0, "~", m_dimensions.column, tilde_face);
+    }
+
+    m_dirty = true;
+}
+
+void TerminalUI::draw_status(const DisplayLine& status_line,
+                             const DisplayLine& mode_line,
+                             const Face& default_face)
+{
+    const LineCount status_line_pos = m_status_on_top ? 0 : m_dimensions.line;
+    m_screen.fill(status_line_pos, 0, m_dimensions.column, {default_face.fg, default_face.bg});
+    m_screen.draw(status_line_pos, 0, status_line, m_dimensions.column, default_face);
+
+    const auto mode_len = mode_line.length();
+    const auto remaining = m_dimensions.column - status_line.length();
+    if (mode_len < remaining)
+    {
+        ColumnCount col = m_dimensions.column - mode_len;
+        m_screen.draw(status_line_pos, col, mode_line, m_dimensions.column, default_face);
+    }
+    else if (remaining > 2)
+    {
+        DisplayLine trimmed_mode_line = mode_line;
+        trimmed_mode_line.trim(mode_len + 2 - remaining, remaining - 2);
+        trimmed_mode_line.insert(trimmed_mode_line.begin(), { "…" });
+        kak_assert(trimmed_mode_line.length() == remaining - 1);
+
+        ColumnCount col = m_dimensions.column - remaining + 1;
+        m_screen.draw(status_line_pos, col, trimmed_mode_line, m_dimensions.column, default_face);
+    }
+
+    if (m_set_title)
+    {
+        String title;
+        for (auto& atom : mode_line)
+        {
+            const auto str = atom.content();
+            for (auto it = str.begin(), end = str.end(); it != end; utf8::to_next(it, end))
+                title += (*it >= 0x20 and *it <= 0x7e) ? *it : '?';
+        }
+        if (title != m_title)
+        {
+            m_title = std::move(title);
+            m_title_changed = true;
+        }
+    }
+
+    m_dirty = true;
+}
+
+void TerminalUI::set_cursor(CursorMode mode, DisplayCoord coord)
+{
+    m_cursor = Cursor{ mode, coord };
+}
+
+void TerminalUI::refresh(bool force)
+{
+    if (not m_terminal_setup)
+        return;
+
+    if (force)
+        std::fill(m_front.cells.begin(), m_front.cells.end(), Cell{invalid_codepoint, {}});
+
+    if (m_dirty or force)
+    {
+        compose();
+        emit_frame();
+    }
+    m_dirty = false;
+}
+
+void TerminalUI::compose()
+{
+    m_back = m_screen;
+
+    for (auto* window : { (const Window*)&m_menu, (const Window*)&m_info })
+    {
+        if (not *window)
+            continue;
+
+        const auto& grid = window->grid;
+        const LineCount end_line = min(window->pos.line + grid.size.line, m_back.size.line);
+        const ColumnCount end_column = min(window->pos.column + grid.size.column, m_back.size.column);
+        for (LineCount line = max(0_line, window->pos.line); line < end_line; ++line)
+        {
+            const Cell* src = grid.line(line - window->pos.line);
+            std::copy(src + (int)max(0_col, -window->pos.column),
+                      src + (int)(end_column - window->pos.column),
+                      m_back.line(line) + (int)max(0_col, window->pos.column));
+        }
+    }
+
+    // Overlapping windows can leave halves of wide codepoints, blank them
+    for (LineCount line = 0; line < m_back.size.line; ++line)
+    {
+        Cell* cells = m_back.line(line);
+        for (int col = 0; col < (int)m_back.size.column; ++col)
+        {
+            const bool is_wide = cells[col].cp != 0 and codepoint_width(cells[col].cp) == 2;
+            if (is_wide and (col + 1 == (int)m_back.size.column or cells[col+1].cp != 0))
+                cells[col].cp = ' ';
+            else if (is_wide)
+                ++col;
+            else if (cells[col].cp == 0)
+                cells[col].cp = ' ';
+        }
+    }
+}
+
+void TerminalUI::emit_move(LineCount line, ColumnCount column)
+{
+    if (m_output_cursor == DisplayCoord{line, column})
+        return;
+    m_output += format("\033[{};{}H", (int)line + 1, (int)column + 1);
+    m_output_cursor = {line, column};
+}
+
+static int closest_256_color(Color color)
+{
+    auto cube_level = [](int value) { return value < 48 ? 0 : value < 115 ? 1 : (value - 35) / 40; };
+    auto level_value = [](int level) { return level == 0 ? 0 : level * 40 + 55; };
+
+    const int r = cube_level(color.r), g = cube_level(color.g), b = cube_level(color.b);
+    const int cube_dist = sq(color.r - level_value(r)) + sq(color.g - level_value(g)) +
+                          sq(color.b - level_value(b));
+
+    const int average = (color.r + color.g + color.b) / 3;
+    const int gray = average > 238 ? 23 : max(0, (average - 3) / 10);
+    const int gray_value = 8 + gray * 10;
+    const int gray_dist = sq(color.r - gray_value) + sq(color.g - gray_value) +
+                          sq(color.b - gray_value);
+
+    return gray_dist < cube_dist ? 232 + gray : 16 + 36 * r + 6 * g + b;
+}
+
+void TerminalUI::emit_color(Color color, bool foreground)
+{
+    const int base = foreground ? 30 : 40;
+    if (color.color == Color::Default)
+        m_output += format(";{}", base + 9);
+    else if (color.color != Color::RGB)
+        m_output += format(";{}", base + color.color - Color::Black);
+    else if (m_true_color)
+        m_output += format(";{};2;{};{};{}", base + 8, color.r, color.g, color.b);
+    else
+        m_output += format(";{};5;{}", base + 8, closest_256_color(color));
+}
+
+void TerminalUI::emit_face(const Face& face)
+{
+    if (m_output_face and *m_output_face == face)
+        return;
+
+    m_output += "\033[0";
+    struct { Attribute attr; const char* code; } attrs[] {
+        { Attribute::Bold, ";1" },
+        { Attribute::Dim, ";2" },
+        { Attribute::Italic, ";3" },
+        { Attribute::Underline, ";4" },
+        { Attribute::Blink, ";5" },
+        { Attribute::Reverse, ";7" },
+    };
+    for (auto& attr : attrs)
+    {
+        if (face.attributes & attr.attr)
+            m_output += attr.code;
+    }
+    emit_color(face.fg, true);
+    emit_color(face.bg, false);
+    m_output += 'm';
+    m_output_face = face;
+}
+
+void TerminalUI::emit_scroll()
+{
+    const LineCount top = m_status_on_top ? 1 : 0;
+    const int line_count = (int)m_dimensions.line;
+    const int columns = (int)m_back.size.column;
+    if (line_count < 2)
+        return;
+
+    auto hash_cells = [columns](const Cell* cells) {
+        size_t hash = 0;
+        for (auto it = cells; it != cells + columns; ++it)
+            hash = combine_hash(hash, hash_values(it->cp, it->face));
+        return hash;
+    };
+    auto row_equal = [&](int back_line, int front_line) {
+        const Cell* back = m_back.line(top + back_line);
+        return std::equal(back, back + columns, m_front.line(top + front_line));
+    };
+
+    HashMap<size_t, int, MemoryDomain::Display> front_lines;
+    for (int line = 0; line < line_count; ++line)
+    {
+        const Cell* cells = m_front.line(top + line);
+        const size_t hash = hash_cells(cells);
+        if (not front_lines.contains(hash))
+            front_lines.insert({hash, line});
+    }
+
+    Vector<int> matches;
+    matches.reserve(line_count);
+    for (int line = 0; line < line_count; ++line)
+    {
+        const int previous = matches.empty() ? -1 : matches.back();
+        int match = -1;
+        if (previous != -1 and previous + 1 < line_count and row_equal(line, previous + 1))
+            match = previous + 1;
+        else
+        {
+            const Cell* cells = m_back.line(top + line);
+            auto it = front_lines.find(hash_cells(cells));
+            if (it != front_lines.end() and row_equal(line, it->value))
+                match = it->value;
+        }
+        matches.push_back(match);
+    }
+
+    const int scroll = dominant_scroll(matches);
+    if (scroll == 0 or abs(scroll) >= line_count)
+        return;
+
+    // Let the terminal move the lines, the ones scrolled in are repainted
+    emit_face(Face{});
+    m_output += format("\033[{};{}r\033[{}{}\033[r", (int)top + 1, (int)top + line_count,
+                       abs(scroll), scroll > 0 ? 'S' : 'T');
+    m_output_cursor = {-1, -1};
+
+    Cell* region = m_front.line(top);
+    Cell* region_end = region + line_count * columns;
+    const Cell invalid{invalid_codepoint, {}};
+    if (scroll > 0)
+    {
+        std::move(region + scroll * columns, region_end, region);
+        std::fill(region_end - scroll * columns, region_end, invalid);
+    }
+    else
+    {
+        std::move_backward(region, region_end + scroll * columns, region_end);
+        std::fill(region, region - scroll * columns, invalid);
+    }
+}
+
+void TerminalUI::emit_frame()
+{
+    emit_scroll();
+
+    const size_t begin_size = (int)m_output.length();
+    const ColumnCount columns = m_back.size.column;
+    for (LineCount line = 0; line < m_back.size.line; ++line)
+    {
+        const Cell* back = m_back.line(line);
+        Cell* front = m_front.line(line);
+        for (int col = 0; col < (int)columns; ++col)
+        {
+            if (back[col] == front[col])
+                continue;
+
+            if (back[col].cp == 0 and col > 0) // rewrite the whole wide codepoint
+                --col;
+
+            // Clear the end of the line at once when it is blank
+            const Face& face = back[col].face;
+            const bool blank_end = face.attributes == Attribute::Normal and
+                (int)columns - col > 4 and
+                std::all_of(back + col, back + (int)columns,
+                            [&](const Cell& cell) { return cell == Cell{' ', face}; });
+            emit_move(line, col);
+            emit_face(face);
+            if (blank_end)
+            {
+                m_output += "\033[K";
+                std::copy(back + col, back + (int)columns, front + col);
+                break;
+            }
+
+            const int width = back[col].cp == 0 ? 1 : (int)codepoint_width(back[col].cp);
+            utf8::dump(std::back_inserter(m_output), back[col].cp);
+            std::copy(back + col, back + col + width, front + col);
+            col += width - 1;
+
+            // Without autowrap, the cursor stays on the last column
+            m_output_cursor.column += width;
+            if (m_output_cursor.column >= columns)
+                m_output_cursor = {-1, -1};
+        }
+    }
+
+    if (m_set_title and m_title_changed)
+    {
+        m_output += "\033]2;" + m_title + " - Kakoune\007";
+        m_title_changed = false;
+    }
+
+    if (m_output.length() == begin_size and m_output_cursor != DisplayCoord{-1, -1})
+        return; // nothing changed
+
+    if (m_cursor.mode == CursorMode::Prompt)
+        emit_move(m_status_on_top ? 0 : m_dimensions.line, m_cursor.coord.column);
+    else
+        emit_move(m_cursor.coord.line + (m_status_on_top ? 1 : 0), m_cursor.coord.column);
+
+    if (m_synchronized)
+        m_output = "\033[?2026h" + m_output + "\033[?2026l";
+
+    write(1, m_output);
+    m_output.clear();
+}
+
+Optional<Key> TerminalUI::get_next_key()
+{
+    if (not m_terminal_setup)
+        return {};
+
+    check_resize();
+    if (m_resize_key_pending)
+    {
+        m_resize_key_pending = false;
+        return resize(m_dimensions);
+    }
+
+    if (m_input_pos == m_input.length())
+    {
+        m_input.clear();
+        m_input_pos = 0;
+    }
+
+    char buffer[4096];
+    while (fd_readable(0))
+    {
+        const ssize_t size = ::read(0, buffer, sizeof(buffer));
+        if (size <= 0)
+            break;
+        m_input += StringView{buffer, buffer + size};
+    }
+
+    // Skip over sequences that do not produce a key, stop on incomplete ones
+    while (m_input_pos != m_input.length())
+    {
+        const ByteCount previous_pos = m_input_pos;
+        if (auto key = parse_next_key())
+            return key;
+        if (m_input_pos == previous_pos)
+            break;
+    }
+    return {};
+}
+
+Optional<Key> TerminalUI::parse_next_key()
+{
+    const char* const begin = m_input.begin() + (int)m_input_pos;
+    const char* const end = m_input.end();
+
+    auto consume = [&, this](const char* pos, Optional<Key> key) {
+        m_input_pos = (int)(pos - m_input.begin());
+        m_escape_timed_out = false;
+        m_escape_timer.set_next_date(TimePoint::max());
+        return key;
+    };
+
+    // Returns true if we should wait for the rest of an escape sequence
+    auto wait_for_more = [this]() {
+        if (m_escape_timed_out)
+            return false;
+        if (m_escape_timer.next_date() == TimePoint::max())
+            m_escape_timer.set_next_date(Clock::now() + escape_delay);
+        return true;
+    };
+
+    auto parse_key = [](const char*& pos, const char* end) -> Optional<Key> {
+        const unsigned char c = *pos;
+        if (c == 127 or c == 8)
+            return ++pos, Key{Key::Backspace};
+        if (c == '\r' or c == '\n')
+            return ++pos, Key{Key::Return};
+        if (c == '\t')
+            return ++pos, Key{Key::Tab};
+        if (c > 0 and c < 27)
+            return ++pos, ctrl(Codepoint(c) - 1 + 'a');
+        if (pos + (int)utf8::codepoint_size((char)c) > end)
+            return {}; // incomplete codepoint
+        return Key{utf8::read_codepoint(pos, end)};
+    };
+
+    auto with_modifiers = [](Key key, int param) {
+        const int mask = max(param - 1, 0);
+        if (mask & 2)
+            key = alt(key);
+        if (mask & 4)
+            key = ctrl(key);
+        return key;
+    };
+
+    const char* pos = begin;
+    if (*pos != 27)
+    {
+        if (*pos == 26) // ctrl-z, suspend
+        {
+            consume(pos + 1, {});
+            restore_terminal();
+            raise(SIGTSTP);
+            setup_terminal();
+            return {};
+        }
+        if (auto key = parse_key(pos, end))
+            return consume(pos, key);
+        return {};
+    }
+
+    ++pos;
+    if (pos == end)
+        return wait_for_more() ? Optional<Key>{} : consume(pos, Key{Key::Escape});
+
+    if (*pos == 'O' and pos + 1 == end and wait_for_more())
+        return {};
+    if (*pos == 'O' and pos + 1 != end) // SS3
+    {
+        switch (pos[1])
+        {
+            case 'A': return consume(pos + 2, Key{Key::Up});
+            case 'B': return consume(pos + 2, Key{Key::Down});
+            case 'C': return consume(pos + 2, Key{Key::Right});
+            case 'D': return consume(pos + 2, Key{Key::Left});
+            case 'H': return consume(pos + 2, Key{Key::Home});
+            case 'F': return consume(pos + 2, Key{Key::End});
+            case 'P': case 'Q': case 'R': case 'S':
+                return consume(pos + 2, Key{Key::F1 + (pos[1] - 'P')});
+        }
+    }
+
+    if (*pos == '[') // CSI
+    {
+        const char* seq = pos + 1;
+        const bool mouse = seq != end and *seq == '<';
+        if (mouse)
+            ++seq;
+
+        int params[4] = {};
+        int param_count = 0;
+        for (; seq != end and ((*seq >= '0' and *seq <= '9') or *seq == ';'); ++seq)
+        {
+            if (*seq == ';')
+                param_count = min(param_count + 1, 3);
+            else
+                params[param_count] = params[param_count] * 10 + (*seq - '0');
+        }
+
+        if (seq == end and wait_for_more())
+            return {};
+        if (seq != end)
+        {
+            const char final = *seq++;
+            if (mouse and (final == 'M' or final == 'm'))
+            {
+                const int button = params[0];
+                Key::Modifiers modifiers{};
+                if (button & 16)
+                    modifiers |= Key::Modifiers::Control;
+                if (button & 8)
+                    modifiers |= Key::Modifiers::Alt;
+
+                const int index = (button & 64) ? 4 + (button & 3) : (button & 3) + 1;
+                if (button & 32)
+                    modifiers |= Key::Modifiers::MousePos;
+                else if (index == 1)
+                    modifiers |= final == 'M' ? Key::Modifiers::MousePress
+                                              : Key::Modifiers::MouseRelease;
+                else if (final == 'M' and index == m_wheel_down_button)
+                    modifiers |= Key::Modifiers::MouseWheelDown;
+                else if (final == 'M' and index == m_wheel_up_button)
+                    modifiers |= Key::Modifiers::MouseWheelUp;
+                else
+                    modifiers |= Key::Modifiers::MousePos;
+
+                const DisplayCoord coord{params[2] - 1 - (m_status_on_top ? 1 : 0),
+                                         params[1] - 1};
+                return consume(seq, Key{modifiers, encode_coord(coord)});
+            }
+
+            switch (final)
+            {
+                case 'A': return consume(seq, with_modifiers(Key::Up, params[1]));
+                case 'B': return consume(seq, with_modifiers(Key::Down, params[1]));
+                case 'C': return consume(seq, with_modifiers(Key::Right, params[1]));
+                case 'D': return consume(seq, with_modifiers(Key::Left, params[1]));
+                case 'H': return consume(seq, with_modifiers(Key::Home, params[1]));
+                case 'F': return consume(seq, with_modifiers(Key::End, params[1]));
+                case 'P': case 'Q': case 'R': case 'S':
+                    return consume(seq, with_modifiers(Key::F1 + (final - 'P'), params[1]));
+                case 'Z': return consume(seq, Key{Key::BackTab});
+                case 'I': return consume(seq, Key{Key::FocusIn});
+                case 'O': return consume(seq, Key{Key::FocusOut});
+                case '~':
+                {
+                    auto key = [](int param) -> Codepoint {
+                        switch (param)
+                        {
+                            case 1: case 7: return Key::Home;
+                            case 3: return Key::Delete;
+                            case 4: case 8: return Key::End;
+                            case 5: return Key::PageUp;
+                            case 6: return Key::PageDown;
+                            case 11: case 12: case 13: case 14: case 15:
+                                return Key::F1 + (param - 11);
+                            case 17: case 18: case 19: case 20: case 21:
+                                return Key::F6 + (param - 17);
+                            case 23: case 24:
+                                return Key::F11 + (param - 23);
+                        }
+                        return Key::Invalid;
+                    }(params[0]);
+                    if (key == Key::Invalid)
+                        return consume(seq, {});
+                    return consume(seq, with_modifiers(key, params[1]));
+                }
+            }
+            if (final >= 0x40 and final <= 0x7e) // ignore unknown sequences
+                return consume(seq, {});
+        }
+    }
+
+    // Not a known sequence, escape is used as alt
+    if (*pos == 27)
+        return consume(pos, Key{Key::Escape});
+    if (auto key = parse_key(pos, end))
+        return consume(pos, alt(*key));
+    if (wait_for_more()) // incomplete codepoint
+        return {};
+    return consume(pos, Key{Key::Escape});
+}
+
+void TerminalUI::draw_menu()
+{
+    // menu show may have not created the window if it did not fit.
+    // so be tolerant.
+    if (not m_menu)
+        return;
+
+    const Face menu_bg{m_menu.bg.fg, m_menu.bg.bg};
+    const int item_count = m_menu.items.size();
+    const LineCount menu_lines = div_round_up(item_count, m_menu.columns);
+    const LineCount& win_height = m_menu.size.line;
+    kak_assert(win_height <= menu_lines);
+
+    const ColumnCount column_width = (m_menu.size.column - 1) / m_menu.columns;
+
+    const int first_item = (int)m_menu.top_line * m_menu.columns;
+    m_menu.items.fetch(first_item, first_item + (int)win_height * m_menu.columns,
+                       m_on_menu_fetch);
+
+    const LineCount mark_height = min(div_round_up(sq(win_height), menu_lines),
+                                      win_height);
+    const LineCount mark_line = (win_height - mark_height) * m_menu.top_line /
+                                max(1_line, menu_lines - win_height);
+    auto& grid = m_menu.grid;
+    for (auto line = 0_line; line < win_height; ++line)
+    {
+        grid.fill(line, 0, m_menu.size.column, menu_bg);
+        for (int col = 0; col < m_menu.columns; ++col)
+        {
+            const int item_idx = (int)(m_menu.top_line + line) * m_menu.columns
+                                 + col;
+            if (item_idx >= item_count)
+                break;
+
+            const DisplayLine* item = m_menu.items.get(item_idx);
+            if (not item)
+                continue;
+
+            const Face& face = item_idx == m_menu.selected_item ? m_menu.fg : m_menu.bg;
+            const ColumnCount begin = column_width * col;
+            const ColumnCount end = grid.draw(line, begin, *item, begin + column_width, face);
+
+            // pad with the face of the last atom, as the other user interfaces
+            Face pad_face = item->atoms().empty() ? face : item->atoms().back().face;
+            if (pad_face.fg == Color::Default)
+                pad_face.fg = face.fg;
+            if (pad_face.bg == Color::Default)
+                pad_face.bg = face.bg;
+            grid.fill(line, end, begin + column_width, pad_face);
+        }
+        const bool is_mark = line >= mark_line and
+                             line < mark_line + mark_height;
+        grid.draw(line, m_menu.size.column - 1, is_mark ? "█" : "░",
+                  m_menu.size.column, menu_bg);
+    }
+    m_dirty = true;
+}
+
+void TerminalUI::menu_show(ConstArrayView<DisplayLine> items, int item_count,
+                           ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
+                           MenuStyle style)
+{
+    menu_hide();
+
+    m_menu.fg = fg;
+    m_menu.bg = bg;
+    m_menu.style = style;
+    m_menu.anchor = anchor;
+    m_menu.items.reset(items, item_count);
+    m_menu.longest = longest;
+
+    create_menu();
+}
+
+void TerminalUI::create_menu()
+{
+    DisplayCoord anchor = m_menu.anchor;
+    if (m_menu.style == MenuStyle::Prompt)
+        anchor = DisplayCoord{m_status_on_top ? 0_line : m_dimensions.line, 0};
+    else if (m_status_on_top)
+        anchor.line += 1;
+
+    DisplayCoord maxsize = m_dimensions;
+    maxsize.column -= anchor.column;
+    if (maxsize.column <= 2)
+        return;
+
+    const int item_count = m_menu.items.size();
+    const ColumnCount longest = m_menu.longest;
+    const bool is_prompt = m_menu.style == MenuStyle::Prompt;
+    m_menu.columns = is_prompt ? max((int)((maxsize.column-1) / (longest+1)), 1) : 1;
+
+    ColumnCount maxlen = maxsize.column-1;
+    if (m_menu.columns > 1 and item_count > 1)
+        maxlen = maxlen / m_menu.columns - 1;
+    m_menu.items.trim(maxlen);
+
+    int height = min(10, div_round_up(item_count, m_menu.columns));
+
+    int line = (int)anchor.line + 1;
+    if (line + height >= (int)maxsize.line)
+        line = (int)anchor.line - height;
+    m_menu.selected_item = item_count;
+    m_menu.top_line = 0;
+
+    auto width = is_prompt ? maxsize.column : min(longest+1, maxsize.column);
+    m_menu.create({line, anchor.column}, {height, width}, {m_menu.bg.fg, m_menu.bg.bg});
+    draw_menu();
+
+    if (m_info)
+        info_show(m_info.title, m_info.content,
+                  m_info.anchor, m_info.face, m_info.style);
+}
+
+void TerminalUI::menu_items(int first, ConstArrayView<DisplayLine> items)
+{
+    m_menu.items.set(first, items);
+    draw_menu();
+}
+
+void TerminalUI::menu_select(int selected)
+{
+    const int item_count = m_menu.items.size();
+    const LineCount menu_lines = div_round_up(item_count, m_menu.columns);
+    if (selected < 0 or selected >= item_count)
+    {
+        m_menu.selected_item = -1;
+        m_menu.top_line = 0;
+    }
+    else
+    {
+        m_menu.selected_item = selected;
+        const LineCount selected_line = m_menu.selected_item / m_menu.columns;
+        const LineCount win_height = m_menu.size.line;
+        kak_assert(menu_lines >= win_height);
+        if (selected_line < m_menu.top_line)
+            m_menu.top_line = selected_line;
+        if (selected_line >= m_menu.top_line + win_height)
+            m_menu.top_line = min(selected_line, menu_lines - win_height);
+    }
+    draw_menu();
+}
+
+void TerminalUI::menu_hide()
+{
+    if (not m_menu)
+        return;
+    m_menu.items.clear();
+    m_menu.destroy();
+    m_dirty = true;
+
+    // Recompute info as it does not have to avoid the menu anymore
+    if (m_info)
+        info_show(m_info.title, m_info.content, m_info.anchor, m_info.face, m_info.style);
+}
+
+void TerminalUI::info_show(StringView title, StringView content,
+                           DisplayCoord anchor, Face face, InfoStyle style)
+{
+    info_hide();
+
+    m_info.title = title.str();
+    m_info.content = content.str();
+    m_info.anchor = anchor;
+    m_info.face = face;
+    m_info.style = style;
+
+    Vector<String> info_box;
+    if (style == InfoStyle::Prompt)
+    {
+        info_box = make_info_box(m_info.title, m_info.content,
+                                 m_dimensions.column, m_assistant);
+        anchor = DisplayCoord{m_status_on_top ? 0 : m_dimensions.line,
+                              m_dimensions.column-1};
+    }
+    else if (style == InfoStyle::Modal)
+        info_box = make_info_box(m_info.title, m_info.content,
+                                 m_dimensions.column, {});
+    else
+    {
+        if (m_status_on_top)
+            anchor.line += 1;
+        ColumnCount col = anchor.column;
+        if (style == InfoStyle::MenuDoc and m_menu)
+            col = m_menu.pos.column + m_menu.size.column;
+
+        const ColumnCount max_width = m_dimensions.column - col;
+        if (max_width < 4)
+            return;
+
+        for (auto& line : wrap_lines(m_info.content, max_width))
+            info_box.push_back(line.str());
+    }
+
+    const DisplayCoord size{(int)info_box.size(),
+                            accumulate(info_box | transform(std::mem_fn(&String::column_length)), 0_col,
+                                       [](ColumnCount lhs, ColumnCount rhs){ return lhs < rhs ? rhs : lhs; })};
+    const Rect rect = {m_status_on_top ? 1_line : 0_line, m_dimensions};
+    DisplayCoord pos;
+    if (style == InfoStyle::MenuDoc and m_menu)
+        pos = m_menu.pos + DisplayCoord{0_line, m_menu.size.column};
+    else if (style == InfoStyle::Modal)
+    {
+        auto half = [](const DisplayCoord& c) { return DisplayCoord{c.line / 2, c.column / 2}; };
+        pos = rect.pos + half(rect.size) - half(size);
+    }
+    else
+        pos = compute_pos(anchor, size, rect, m_menu, style == InfoStyle::InlineAbove);
+
+    // The info box does not fit
+    if (pos < rect.pos or pos + size > rect.pos + rect.size or size.column == 0)
+        return;
+
+    m_info.create(pos, size, face);
+    for (size_t line = 0; line < info_box.size(); ++line)
+        m_info.grid.draw(LineCount{(int)line}, 0, StringView{info_box[line]}, size.column, face);
+    m_dirty = true;
+}
+
+void TerminalUI::info_hide()
+{
+    if (not m_info)
+        return;
+    m_info.destroy();
+    m_dirty = true;
+}
+
+void TerminalUI::set_on_key(OnKeyCallback callback)
+{
+    m_on_key = std::move(callback);
+}
+
+void TerminalUI::set_on_menu_fetch(OnMenuFetchCallback callback)
+{
+    m_on_menu_fetch = std::move(callback);
+}
+
+DisplayCoord TerminalUI::dimensions()
+{
+    return m_dimensions;
+}
+
+void TerminalUI::enable_mouse(bool enabled)
+{
+    if (enabled == m_mouse_enabled)
+        return;
+
+    m_mouse_enabled = enabled;
+    if (m_terminal_setup)
+        write(1, enabled ? "\033[?1002h\033[?1006h" : "\033[?1006l\033[?1002l");
+}
+
+void TerminalUI::set_ui_options(const Options& options)
+{
+    auto enabled = [&](StringView name, bool default_value) {
+        auto it = options.find(name);
+        return it == options.end() ? default_value
+                                   : (it->value == "yes" or it->value == "true");
+    };
+
+    {
+        auto it = options.find("terminal_assistant"_sv);
+        if (auto assistant = find_assistant(it != options.end() ? it->value : "clippy"))
+            m_assistant = *assistant;
+    }
+
+    m_status_on_top = enabled("terminal_status_on_top", false);
+    m_set_title = enabled("terminal_set_title", true);
+    m_true_color = enabled("terminal_true_color", true);
+    m_synchronized = enabled("terminal_synchronized_output", true);
+
+    // Colors might be emitted differently, repaint everything
+    std::fill(m_front.cells.begin(), m_front.cells.end(), Cell{invalid_codepoint, {}});
+    m_output_face.reset();
+    m_dirty = true;
+
+    {
+        enable_mouse(enabled("terminal_enable_mouse", true));
+
+        auto wheel_up_it = options.find("terminal_wheel_up_button"_sv);
+        m_wheel_up_button = wheel_up_it != options.end() ?
+            str_to_int_ifp(wheel_up_it->value).value_or(4) : 4;
+
+        auto wheel_down_it = options.find("terminal_wheel_down_button"_sv);
+        m_wheel_down_button = wheel_down_it != options.end() ?
+            str_to_int_ifp(wheel_down_it->value).value_or(5) : 5;
+    }
+}
+
+}
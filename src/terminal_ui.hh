@@ -0,0 +1,193 @@
+#ifndef terminal_ui_hh_INCLUDED
+#define terminal_ui_hh_INCLUDED
+
+#include "array_view.hh"
+#include "coord.hh"
+#include "display_buffer.hh"
+#include "event_manager.hh"
+#include "face.hh"
+#include "string.hh"
+#include "ui_layout.hh"
+#include "user_interface.hh"
+#include "vector.hh"
+
+#include <termios.h>
+
+namespace Kakoune
+{
+
+// Terminal user interface writing VT sequences directly, without ncurses.
+//
+// Everything is drawn in a back grid of cells, which is compared on refresh
+// with the front grid holding what the terminal currently displays. Only
+// the differences are emitted, in a single write wrapped in synchronized
+// update markers so that the terminal displays complete frames.
+class TerminalUI : public UserInterface
+{
+public:
+    TerminalUI();
+    ~TerminalUI() override;
+
+    TerminalUI(const TerminalUI&) = delete;
+    TerminalUI& operator=(const TerminalUI&) = delete;
+
+    void draw(const DisplayBuffer& display_buffer,
+              const Face& default_face,
+              const Face& padding_face) override;
+
+    void draw_status(const DisplayLine& status_line,
+                     const DisplayLine& mode_line,
+                     const Face& default_face) override;
+
+    void menu_show(ConstArrayView<DisplayLine> items, int item_count,
+                   ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
+                   MenuStyle style) override;
+    void menu_items(int first, ConstArrayView<DisplayLine> items) override;
+    void menu_select(int selected) override;
+    void menu_hide() override;
+
+    void info_show(StringView title, StringView content,
+                   DisplayCoord anchor, Face face,
+                   InfoStyle style) override;
+    void info_hide() override;
+
+    void set_cursor(CursorMode mode, DisplayCoord coord) override;
+
+    void refresh(bool force) override;
+
+    DisplayCoord dimensions() override;
+    void set_on_key(OnKeyCallback callback) override;
+    void set_on_menu_fetch(OnMenuFetchCallback callback) override;
+    void set_ui_options(const Options& options) override;
+
+    static void abort();
+
+protected:
+    void on_sighup();
+
+private:
+    struct Cell
+    {
+        Codepoint cp = ' '; // 0 for the right half of a wide codepoint
+        Face face;
+
+        friend bool operator==(const Cell& lhs, const Cell& rhs)
+        {
+            return lhs.cp == rhs.cp and lhs.face == rhs.face;
+        }
+        friend bool operator!=(const Cell& lhs, const Cell& rhs) { return not (lhs == rhs); }
+    };
+
+    struct Grid
+    {
+        void resize(DisplayCoord new_size, const Cell& cell);
+        Cell* line(LineCount line) { return &cells[(size_t)(int)line * (int)size.column]; }
+        const Cell* line(LineCount line) const { return &cells[(size_t)(int)line * (int)size.column]; }
+
+        // draw content on line starting at column, stopping before max_column,
+        // returns the column following the drawn content.
+        ColumnCount draw(LineCount line, ColumnCount column, StringView content,
+                         ColumnCount max_column, const Face& face);
+        ColumnCount draw(LineCount line, ColumnCount column, const DisplayLine& content,
+                         ColumnCount max_column, const Face& default_face);
+        void fill(LineCount line, ColumnCount column, ColumnCount end, const Face& face);
+
+        DisplayCoord size;
+        Vector<Cell, MemoryDomain::Display> cells;
+    };
+
+    struct Window : Rect
+    {
+        void create(const DisplayCoord& pos, const DisplayCoord& size, const Face& face);
+        void destroy();
+
+        explicit operator bool() const { return not grid.cells.empty(); }
+
+        Grid grid;
+    };
+
+    void setup_terminal();
+    void restore_terminal();
+    void check_resize(bool force = false);
+
+    void compose();
+    void emit_frame();
+    void emit_scroll();
+    void emit_face(const Face& face);
+    void emit_color(Color color, bool foreground);
+    void emit_move(LineCount line, ColumnCount column);
+
+    Optional<Key> get_next_key();
+    Optional<Key> parse_next_key();
+    void create_menu();
+    void draw_menu();
+
+    Grid m_screen;           // main window and status line
+    Grid m_back;             // m_screen with the menu and info box on top
+    Grid m_front;            // what is currently displayed by the terminal
+    String m_output;         // sequences for the frame being emitted
+    DisplayCoord m_output_cursor;
+    Optional<Face> m_output_face;
+
+    DisplayCoord m_dimensions;
+    bool m_dirty = false;
+
+    struct Menu : Window
+    {
+        MenuItems items;
+        ColumnCount longest = 1;
+        Face fg;
+        Face bg;
+        DisplayCoord anchor;
+        MenuStyle style;
+        int selected_item = 0;
+        int columns = 1;
+        LineCount top_line = 0;
+    } m_menu;
+
+    struct Info : Window
+    {
+        String title;
+        String content;
+        Face face;
+        DisplayCoord anchor;
+        InfoStyle style;
+    } m_info;
+
+    struct Cursor
+    {
+        CursorMode mode;
+        DisplayCoord coord;
+    } m_cursor;
+
+    FDWatcher m_stdin_watcher;
+    Timer m_escape_timer;
+    bool m_escape_timed_out = false;
+    OnKeyCallback m_on_key;
+    OnMenuFetchCallback m_on_menu_fetch;
+    String m_input;          // bytes read from the terminal
+    ByteCount m_input_pos = 0; // first byte of m_input not parsed yet
+    bool m_resize_key_pending = false;
+
+    termios m_original_termios;
+    bool m_terminal_setup = false;
+
+    bool m_status_on_top = false;
+    ConstArrayView<StringView> m_assistant;
+
+    void enable_mouse(bool enabled);
+
+    bool m_mouse_enabled = false;
+    int m_wheel_up_button = 4;
+    int m_wheel_down_button = 5;
+
+    bool m_set_title = true;
+    String m_title;
+    bool m_title_changed = false;
+    bool m_true_color = true;
+    bool m_synchronized = true;
+};
+
+}
+
+#endif // terminal_ui_hh_INCLUDED
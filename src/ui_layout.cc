@@ -0,0 +1,228 @@
+#include "ui_layout.hh"
+
+#include "hash_map.hh"
+#include "string_utils.hh"
+
+namespace Kakoune
+{
+
+using std::min;
+using std::max;
+
+static constexpr StringView assistant_cat[] =
+    { R"(  ___            )",
+      R"( (__ \           )",
+      R"(   / /          ╭)",
+      R"(  .' '·.        │)",
+      R"( '      ”       │)",
+      R"( ╰       /\_/|  │)",
+      R"(  | .         \ │)",
+      R"(  ╰_J`    | | | ╯)",
+      R"(      ' \__- _/  )",
+      R"(      \_\   \_\  )",
+      R"(                 )"};
+
+static constexpr StringView assistant_clippy[] =
+    { " ╭──╮   ",
+      " │  │   ",
+      " @  @  ╭",
+      " ││ ││ │",
+      " ││ ││ ╯",
+      " │╰─╯│  ",
+      " ╰───╯  ",
+      "        " };
+
+static constexpr StringView assistant_dilbert[] =
+    { R"(  დოოოოოდ   )",
+      R"(  |     |   )",
+      R"(  |     |  ╭)",
+      R"(  |-ᱛ ᱛ-|  │)",
+      R"( Ͼ   ∪   Ͽ │)",
+      R"(  |     |  ╯)",
+      R"( ˏ`-.ŏ.-´ˎ  )",
+      R"(     @      )",
+      R"(      @     )",
+      R"(            )"};
+
+Optional<ConstArrayView<StringView>> find_assistant(StringView name)
+{
+    if (name == "clippy")
+        return ConstArrayView<StringView>{assistant_clippy};
+    if (name == "cat")
+        return ConstArrayView<StringView>{assistant_cat};
+    if (name == "dilbert")
+        return ConstArrayView<StringView>{assistant_dilbert};
+    if (name == "none" or name == "off")
+        return ConstArrayView<StringView>{};
+    return {};
+}
+
+DisplayCoord compute_pos(DisplayCoord anchor, DisplayCoord size,
+                         Rect rect, Rect to_avoid, bool prefer_above)
+{
+    DisplayCoord pos;
+    if (prefer_above)
+    {
+        pos = anchor - DisplayCoord{size.line};
+        if (pos.line < 0)
+            prefer_above = false;
+    }
+    auto rect_end = rect.pos + rect.size;
+    if (not prefer_above)
+    {
+        pos = anchor + DisplayCoord{1_line};
+        if (pos.line + size.line > rect_end.line)
+            pos.line = max(rect.pos.line, anchor.line - size.line);
+    }
+    if (pos.column + size.column > rect_end.column)
+        pos.column = max(rect.pos.column, rect_end.column - size.column);
+
+    if (to_avoid.size != DisplayCoord{})
+    {
+        DisplayCoord to_avoid_end = to_avoid.pos + to_avoid.size;
+
+        DisplayCoord end = pos + size;
+
+        // check intersection
+        if (not (end.line < to_avoid.pos.line or end.column < to_avoid.pos.column or
+                 pos.line > to_avoid_end.line or pos.column > to_avoid_end.column))
+        {
+            pos.line = min(to_avoid.pos.line, anchor.line) - size.line;
+            // if above does not work, try below
+            if (pos.line < 0)
+                pos.line = max(to_avoid_end.line, anchor.line);
+        }
+    }
+
+    return pos;
+}
+
+Vector<String> make_info_box(StringView title, StringView message, ColumnCount max_width,
+                             ConstArrayView<StringView> assistant)
+{
+    DisplayCoord assistant_size;
+    if (not assistant.empty())
+        assistant_size = { (int)assistant.size(), assistant[0].column_length() };
+
+    Vector<String> result;
+
+    const ColumnCount max_bubble_width = max_width - assistant_size.column - 6;
+    if (max_bubble_width < 4)
+        return result;
+
+    Vector<StringView> lines = wrap_lines(message, max_bubble_width);
+
+    ColumnCount bubble_width = title.column_length() + 2;
+    for (auto& line : lines)
+        bubble_width = max(bubble_width, line.column_length());
+
+    auto line_count = max(assistant_size.line-1,
+                          LineCount{(int)lines.size()} + 2);
+    const auto assistant_top_margin = (line_count - assistant_size.line+1) / 2;
+    for (LineCount i = 0; i < line_count; ++i)
+    {
+        String line;
+        constexpr Codepoint dash{L'─'};
+        if (not assistant.empty())
+        {
+            if (i >= assistant_top_margin)
+                line += assistant[(int)min(i - assistant_top_margin, assistant_size.line-1)];
+            else
+                line += assistant[(int)assistant_size.line-1];
+        }
+        if (i == 0)
+        {
+            if (title.empty())
+                line += "╭─" + String{dash, bubble_width} + "─╮";
+            else
+            {
+                auto dash_count = bubble_width - title.column_length() - 2;
+                String left{dash, dash_count / 2};
+                String right{dash, dash_count - dash_count / 2};
+                line += "╭─" + left + "┤" + title +"├" + right +"─╮";
+            }
+        }
+        else if (i < lines.size() + 1)
+        {
+            auto& info_line = lines[(int)i - 1];
+            const ColumnCount padding = bubble_width - info_line.column_length();
+            line += "│ " + info_line + String{' ', padding} + " │";
+        }
+        else if (i == lines.size() + 1)
+            line += "╰─" + String(dash, bubble_width) + "─╯";
+
+        result.push_back(std::move(line));
+    }
+    return result;
+}
+
+int dominant_scroll(ConstArrayView<int> matches)
+{
+    HashMap<int, int, MemoryDomain::Display> counts;
+    int best = 0, best_count = 0;
+    for (int i = 0; i < matches.size(); ++i)
+    {
+        if (matches[i] == -1)
+            continue;
+        const int offset = matches[i] - i;
+        auto it = counts.find(offset);
+        const int count = it != counts.end() ? ++it->value
+                                             : counts.insert({offset, 1});
+        if (count > best_count or (count == best_count and offset == 0))
+        {
+            best = offset;
+            best_count = count;
+        }
+    }
+    return best;
+}
+
+void MenuItems::reset(ConstArrayView<DisplayLine> items, int item_count)
+{
+    kak_assert(items.size() <= item_count);
+    m_items.clear();
+    m_items.resize(item_count);
+    std::copy(items.begin(), items.end(), m_items.begin());
+    m_max_length = -1;
+    m_requested_begin = m_requested_end = 0;
+}
+
+void MenuItems::trim(ColumnCount max_length)
+{
+    m_max_length = max_length;
+    for (auto& item : m_items)
+    {
+        if (item)
+            item->trim(0, max_length);
+    }
+}
+
+void MenuItems::set(int first, ConstArrayView<DisplayLine> items)
+{
+    const int end = min(first + (int)items.size(), size());
+    for (int i = max(first, 0); i < end; ++i)
+    {
+        m_items[i] = items[i - first];
+        if (m_max_length >= 0)
+            m_items[i]->trim(0, m_max_length);
+    }
+}
+
+void MenuItems::fetch(int begin, int end, const OnMenuFetchCallback& fetch_items)
+{
+    end = min(end, size());
+    const int prefetch_count = end - begin;
+    while (begin < end and m_items[begin])
+        ++begin;
+    while (end > begin and m_items[end-1])
+        --end;
+    if (begin == end or not fetch_items or
+        (begin >= m_requested_begin and end <= m_requested_end))
+        return;
+
+    m_requested_begin = begin;
+    m_requested_end = min(end + prefetch_count, size());
+    fetch_items(m_requested_begin, m_requested_end - m_requested_begin);
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef ui_layout_hh_INCLUDED
+#define ui_layout_hh_INCLUDED
+
+#include "array_view.hh"
+#include "coord.hh"
+#include "display_buffer.hh"
+#include "optional.hh"
+#include "string.hh"
+#include "user_interface.hh"
+#include "vector.hh"
+
+namespace Kakoune
+{
+
+struct Rect
+{
+    DisplayCoord pos;
+    DisplayCoord size;
+};
+
+// Returns the assistant drawn next to prompt info boxes with the given name,
+// none and off select no assistant.
+Optional<ConstArrayView<StringView>> find_assistant(StringView name);
+
+// Position of a box of given size near anchor, preferably below it, inside
+// rect and not overlapping to_avoid.
+DisplayCoord compute_pos(DisplayCoord anchor, DisplayCoord size,
+                         Rect rect, Rect to_avoid, bool prefer_above);
+
+Vector<String> make_info_box(StringView title, StringView message, ColumnCount max_width,
+                             ConstArrayView<StringView> assistant);
+
+// Most common offset between lines and the previous lines they match,
+// matches containing the previous index of each line, or -1.
+int dominant_scroll(ConstArrayView<int> matches);
+
+// Items of a menu, of which only the first ones are received with the menu,
+// the others are fetched when they need to be displayed.
+class MenuItems
+{
+public:
+    void reset(ConstArrayView<DisplayLine> items, int item_count);
+    void clear() { reset({}, 0); }
+
+    // Trim received items to max_length, and the ones received later
+    void trim(ColumnCount max_length);
+    void set(int first, ConstArrayView<DisplayLine> items);
+
+    // Request the items of [begin, end) not received yet, along with the
+    // following ones so that scrolling does not need to wait for them.
+    void fetch(int begin, int end, const OnMenuFetchCallback& fetch_items);
+
+    int size() const { return (int)m_items.size(); }
+    // Returns nullptr if the item was not received yet
+    const DisplayLine* get(int index) const
+    {
+        return m_items[index] ? &*m_items[index] : nullptr;
+    }
+
+private:
+    Vector<Optional<DisplayLine>, MemoryDomain::Display> m_items;
+    ColumnCount m_max_length = -1;
+    int m_requested_begin = 0;
+    int m_requested_end = 0;
+};
+
+}
+
+#endif // ui_layout_hh_INCLUDED
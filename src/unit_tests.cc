@@ -2,6 +2,7 @@
 
 #include "assert.hh"
 #include "diff.hh"
+#include "string_utils.hh"
 #include "utf8.hh"
 #include "string.hh"
 
@@ -52,6 +53,46 @@ UnitTest test_diff{[]()
         auto diff = find_diff(s1.begin(), (int)s1.length(), s2.begin(), (int)s2.length());
         kak_assert(diff.size() == 11);
     }
+
+    {
+        Vector<StringView> a = { "a\n", "b\n", "c\n", "d\n" };
+        Vector<StringView> b = { "a\n", "x\n", "c\n", "d\n", "e\n" };
+        auto diff = find_hashed_diff(a.begin(), (int)a.size(), b.begin(), (int)b.size(),
+                                     [](StringView s) { return hash_value(s); });
+        kak_assert(diff.size() == 5 and
+                   eq(diff[0], {Diff::Keep, 1, 0}) and
+                   eq(diff[1], {Diff::Remove, 1, 0}) and
+                   eq(diff[2], {Diff::Add, 1, 1}) and
+                   eq(diff[3], {Diff::Keep, 2, 0}) and
+                   eq(diff[4], {Diff::Add, 1, 4}));
+    }
+
+    {
+        // large enough to be split on unique lines, applying the diff must give b back
+        Vector<String> a, b;
+        for (int i = 0; i < 2000; ++i)
+        {
+            a.push_back(i % 7 == 0 ? String{"common"} : to_string(i));
+            if (i % 13 != 0)
+                b.push_back(i % 11 == 0 ? String{"new"} : a.back());
+            if (i % 17 == 0)
+                b.push_back(to_string(-i));
+        }
+        auto diff = find_hashed_diff(a.begin(), (int)a.size(), b.begin(), (int)b.size(),
+                                     [](const String& s) { return hash_value(s); });
+        Vector<String> res;
+        int posA = 0;
+        for (auto& d : diff)
+        {
+            if (d.mode == Diff::Keep)
+                res.insert(res.end(), a.begin() + posA, a.begin() + posA + d.len);
+            else if (d.mode == Diff::Add)
+                res.insert(res.end(), b.begin() + d.posB, b.begin() + d.posB + d.len);
+            if (d.mode != Diff::Add)
+                posA += d.len;
+        }
+        kak_assert(posA == (int)a.size() and res == b);
+    }
 }};
 
 UnitTest* UnitTest::list = nullptr;
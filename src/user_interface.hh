@@ -3,6 +3,7 @@
 
 #include "array_view.hh"
 #include "hash_map.hh"
+#include "units.hh"
 
 #include <functional>
 
@@ -41,15 +42,21 @@ enum class CursorMode
 };
 
 using OnKeyCallback = std::function<void(Key key)>;
+using OnMenuFetchCallback = std::function<void(int first, int count)>;
 
 class UserInterface
 {
 public:
     virtual ~UserInterface() = default;
 
-    virtual void menu_show(ConstArrayView<DisplayLine> choices,
-                           DisplayCoord anchor, Face fg, Face bg,
+    // Show a menu of item_count items, choices being the first ones. The
+    // others are to be requested through the menu fetch callback when they
+    // need to be displayed, and get provided by menu_items. longest is the
+    // length of the longest of all the items.
+    virtual void menu_show(ConstArrayView<DisplayLine> choices, int item_count,
+                           ColumnCount longest, DisplayCoord anchor, Face fg, Face bg,
                            MenuStyle style) = 0;
+    virtual void menu_items(int first, ConstArrayView<DisplayLine> choices) = 0;
     virtual void menu_select(int selected) = 0;
     virtual void menu_hide() = 0;
 
@@ -73,6 +80,7 @@ public:
     virtual void refresh(bool force) = 0;
 
     virtual void set_on_key(OnKeyCallback callback) = 0;
+    virtual void set_on_menu_fetch(OnMenuFetchCallback callback) = 0;
 
     using Options = HashMap<String, String, MemoryDomain::Options>;
     virtual void set_ui_options(const Options& options) = 0;
@@ -108,7 +108,7 @@ bool Window::needs_redraw(const Context& context) const
 
 const DisplayBuffer& Window::update_display_buffer(const Context& context)
 {
-    const bool profile = context.options()["debug"].get<DebugFlags>() &
+    const bool profile = context.options().get(debug_option) &
                         DebugFlags::Profile;
 
     auto start_time = profile ? Clock::now() : Clock::time_point{};
@@ -125,7 +125,7 @@ const DisplayBuffer& Window::update_display_buffer(const Context& context)
     m_position = setup.window_pos;
     m_range = setup.window_range;
 
-    const int tabstop = context.options()["tabstop"].get<int>();
+    const int tabstop = context.options().get(tabstop_option);
     for (LineCount line = 0; line < m_range.line; ++line)
     {
         LineCount buffer_line = m_position.line + line;
@@ -182,11 +182,11 @@ void Window::set_dimensions(DisplayCoord dimensions)
 
 DisplaySetup Window::compute_display_setup(const Context& context)
 {
-    DisplayCoord offset = options()["scrolloff"].get<DisplayCoord>();
+    DisplayCoord offset = options().get(scrolloff_option);
     offset.line = std::min(offset.line, (m_dimensions.line + 1) / 2);
     offset.column = std::min(offset.column, (m_dimensions.column + 1) / 2);
 
-    const int tabstop = context.options()["tabstop"].get<int>();
+    const int tabstop = context.options().get(tabstop_option);
     const auto& cursor = context.selections().main().cursor();
 
     // Ensure cursor line is visible
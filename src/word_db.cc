@@ -1,6 +1,7 @@
 #include "word_db.hh"
 
 #include "utils.hh"
+#include "ranges.hh"
 #include "line_modification.hh"
 #include "utf8_iterator.hh"
 #include "unit_tests.hh"
@@ -32,22 +33,41 @@ static WordList get_words(StringView content, ConstArrayView<Codepoint> extra_wo
 
 static ConstArrayView<Codepoint> get_extra_word_chars(const Buffer& buffer)
 {
-    return buffer.options()["extra_word_chars"].get<Vector<Codepoint, MemoryDomain::Options>>();
+    return buffer.options().get(extra_word_chars_option);
+}
+
+SharedWordIndex& shared_word_index()
+{
+    static SharedWordIndex index;
+    return index;
+}
+
+static void add_shared_word(const Buffer& buffer, StringView word, int count)
+{
+    auto& counts = shared_word_index().add(word, count).info;
+    auto it = find_if(counts, [&](const BufferWordCount& c) { return c.buffer == &buffer; });
+    if (it != counts.end())
+        it->count += count;
+    else
+        counts.push_back({&buffer, count});
+}
+
+static void remove_shared_word(const Buffer& buffer, StringView word, int count)
+{
+    auto& counts = shared_word_index().remove(word, count).info;
+    auto it = find_if(counts, [&](const BufferWordCount& c) { return c.buffer == &buffer; });
+    kak_assert(it != counts.end() and it->count >= count);
+    if ((it->count -= count) == 0)
+        counts.erase(it);
 }
 
 void WordDB::add_words(StringView line)
 {
     for (auto& w : get_words(line, get_extra_word_chars(*m_buffer)))
     {
-        auto it = m_words.find(w);
-        if (it != m_words.end())
-            ++it->value.refcount;
-        else
-        {
-            auto word = intern(w);
-            auto view = word->strview();
-            m_words.insert({view, {std::move(word), used_letters(view), 1}});
-        }
+        m_words.add(w);
+        if (m_shared)
+            add_shared_word(*m_buffer, w, 1);
     }
 }
 
@@ -55,15 +75,25 @@ void WordDB::remove_words(StringView line)
 {
     for (auto& w : get_words(line, get_extra_word_chars(*m_buffer)))
     {
-        auto it = m_words.find(w);
-        kak_assert(it != m_words.end() and it->value.refcount > 0);
-        if (--it->value.refcount == 0)
-            m_words.unordered_remove(it->key);
+        m_words.remove(w);
+        if (m_shared)
+            remove_shared_word(*m_buffer, w, 1);
     }
 }
 
-WordDB::WordDB(const Buffer& buffer)
-    : m_buffer{&buffer}
+// Remove this buffer words from the shared index
+void WordDB::unshare_words()
+{
+    if (not m_shared)
+        return;
+    m_words.for_each_word([this](const WordIndex<NoInfo>::Word& word) {
+        remove_shared_word(*m_buffer, word.word->strview(), word.count);
+    });
+    shared_word_index().compact_ifn();
+}
+
+WordDB::WordDB(const Buffer& buffer, bool shared)
+    : m_buffer{&buffer}, m_shared{shared}
 {
     buffer.options().register_watcher(*this);
     rebuild_db();
@@ -71,6 +101,7 @@ WordDB::WordDB(const Buffer& buffer)
 
 WordDB::WordDB(WordDB&& other) noexcept
     : m_buffer{std::move(other.m_buffer)},
+      m_shared{other.m_shared},
       m_timestamp{other.m_timestamp},
       m_words{std::move(other.m_words)},
       m_lines{std::move(other.m_lines)}
@@ -85,13 +116,17 @@ WordDB::WordDB(WordDB&& other) noexcept
 WordDB::~WordDB()
 {
     if (m_buffer)
+    {
+        unshare_words();
         m_buffer->options().unregister_watcher(*this);
+    }
 }
 
 void WordDB::rebuild_db()
 {
     auto& buffer = *m_buffer;
 
+    unshare_words();
     m_words.clear();
     m_lines.clear();
     m_lines.reserve((int)buffer.line_count());
@@ -102,7 +137,6 @@ void WordDB::rebuild_db()
     }
     m_timestamp = buffer.timestamp();
 }
-
 void WordDB::update_db()
 {
     auto& buffer = *m_buffer;
@@ -143,6 +177,10 @@ void WordDB::update_db()
         new_lines.push_back(std::move(m_lines[(int)old_line++]));
 
     m_lines = std::move(new_lines);
+
+    m_words.compact_ifn();
+    if (m_shared)
+        shared_word_index().compact_ifn();
 }
 
 void WordDB::on_option_changed(const Option& option)
@@ -153,24 +191,13 @@ void WordDB::on_option_changed(const Option& option)
 
 int WordDB::get_word_occurences(StringView word) const
 {
-    auto it = m_words.find(word);
-    if (it != m_words.end())
-        return it->value.refcount;
-    return 0;
+    return m_words.get_count(word);
 }
 
-RankedMatchList WordDB::find_matching(StringView query)
+RankedMatchList WordDB::find_matching(StringView query, size_t max_count)
 {
     update_db();
-    const UsedLetters letters = used_letters(query);
-    RankedMatchList res;
-    for (auto&& word : m_words)
-    {
-        if (RankedMatch match{word.key, word.value.letters, query, letters})
-            res.push_back(match);
-    }
-
-    return res;
+    return m_words.find_matching(query, max_count);
 }
 
 UnitTest test_word_db{[]()
@@ -207,6 +234,94 @@ UnitTest test_word_db{[]()
     res = word_db.find_matching("");
     std::sort(res.begin(), res.end(), cmp_words);
     kak_assert(eq(res, WordList{ "allo", "mutch", "retchou", "tchou" }));
+    res = word_db.find_matching("tch");
+    std::sort(res.begin(), res.end(), cmp_words);
+    kak_assert(eq(res, WordList{ "mutch", "retchou", "tchou" }));
+    kak_assert(eq(word_db.find_matching("tch", 2), WordList{ "tchou", "mutch" }));
+    kak_assert(eq(word_db.find_matching("ALO"), WordList{}));
+    buffer.insert({0, 0}, "Allo ");
+    kak_assert(eq(word_db.find_matching("Al", 1), WordList{ "Allo" }));
+    kak_assert(eq(word_db.find_matching("al", 2), WordList{ "allo", "Allo" }));
+
+    // removed words are not matched anymore
+    String many_words;
+    for (int i = 0; i < 20; ++i)
+        many_words += format("word{} ", i);
+    buffer.insert({0, 0}, many_words + "\n");
+    kak_assert(word_db.find_matching("word1", 5).size() == 5);
+    buffer.erase({0, 0}, {1, 0});
+    kak_assert(word_db.find_matching("word").empty());
+    kak_assert(word_db.get_word_occurences("word42") == 0);
+    kak_assert(eq(word_db.find_matching("tch", 2), WordList{ "tchou", "mutch" }));
+}};
+
+UnitTest test_word_index_compaction{[]()
+{
+    auto matching = [](const WordIndex<int>& index, StringView query) {
+        Vector<StringView> res;
+        for (auto& match : index.find_matching(query))
+            res.push_back(match.candidate());
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+
+    // removed words are only dropped once there are more than 1024 of them
+    WordIndex<int> index;
+    index.add("tchou", 2);
+    index.add("mutch");
+    for (int i = 0; i < 1100; ++i)
+        index.add(format("word{}", i));
+    for (int i = 0; i < 1100; ++i)
+        index.remove(format("word{}", i));
+    index.add("word7");
+    index.compact_ifn();
+
+    kak_assert(index.get_count("word8") == 0);
+    kak_assert(index.get_count("word7") == 1);
+    kak_assert(index.get_count("tchou") == 2);
+    kak_assert((matching(index, "tch") == Vector<StringView>{ "mutch", "tchou" }));
+    kak_assert((matching(index, "word") == Vector<StringView>{ "word7" }));
+
+    // letter indices of the kept words were remapped
+    index.add("kanaky");
+    kak_assert((matching(index, "kny") == Vector<StringView>{ "kanaky" }));
+    kak_assert((matching(index, "u") == Vector<StringView>{ "mutch", "tchou" }));
+}};
+
+UnitTest test_shared_word_index{[]()
+{
+    auto counts = [](StringView word) {
+        Vector<std::pair<String, int>> res;
+        shared_word_index().for_each_match(word, [&](const SharedWordIndex::Word& w, const RankedMatch&) {
+            if (w.word->strview() != word)
+                return;
+            for (auto& c : w.info)
+                res.emplace_back(c.buffer->name(), c.count);
+        });
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+    using Counts = Vector<std::pair<String, int>>;
+
+    Buffer buffer1("shared1", Buffer::Flags::None, "tchou mutch\ntchou\n");
+    Buffer buffer2("shared2", Buffer::Flags::None, "tchou kanaky\n");
+    {
+        WordDB word_db1(buffer1, true);
+        WordDB word_db2(buffer2, true);
+        WordDB word_db3(buffer2);
+        kak_assert(shared_word_index().get_count("tchou") == 3);
+        kak_assert((counts("tchou") == Counts{{"shared1", 2}, {"shared2", 1}}));
+        kak_assert((counts("kanaky") == Counts{{"shared2", 1}}));
+
+        buffer1.erase({0, 0}, {1, 0});
+        buffer2.insert({0, 0}, "mutch ");
+        word_db1.update_db();
+        word_db2.update_db();
+        kak_assert((counts("tchou") == Counts{{"shared1", 1}, {"shared2", 1}}));
+        kak_assert((counts("mutch") == Counts{{"shared2", 1}}));
+    }
+    kak_assert(shared_word_index().get_count("tchou") == 0);
+    kak_assert(counts("tchou").empty());
 }};
 
 }
@@ -7,44 +7,238 @@
 #include "vector.hh"
 #include "ranked_match.hh"
 
+#include <algorithm>
+
 namespace Kakoune
 {
 
 using RankedMatchList = Vector<RankedMatch>;
 
+// Set of words with their occurrence count, indexed by the letters they
+// contain so that matching a query only looks at the words containing its
+// least common letter. Info is additional data stored with each word.
+template<typename Info>
+class WordIndex
+{
+public:
+    struct Word
+    {
+        StringDataPtr word;
+        UsedLetters letters;
+        int count;
+        Info info;
+    };
+
+    // Add count occurrences of word, the returned reference stays valid
+    // until the next call to compact_ifn or clear.
+    Word& add(StringView word, int count = 1)
+    {
+        auto it = m_words.find(word);
+        if (it != m_words.end())
+        {
+            if (it->value.count == 0)
+                --m_removed_words;
+            it->value.count += count;
+            return it->value;
+        }
+
+        auto interned = intern(word);
+        auto view = interned->strview();
+        const int index = (int)m_words.size();
+        const UsedLetters letters = used_letters(view);
+        for_each_letter(to_lower(letters), [&](int bit) {
+            m_letter_words[bit].push_back(index);
+        });
+        return m_words.insert({view, {std::move(interned), letters, count, {}}});
+    }
+
+    // Remove count occurrences of word, which must have at least that many
+    Word& remove(StringView word, int count = 1)
+    {
+        auto it = m_words.find(word);
+        kak_assert(it != m_words.end() and it->value.count >= count);
+        if ((it->value.count -= count) == 0)
+            ++m_removed_words;
+        return it->value;
+    }
+
+    int get_count(StringView word) const
+    {
+        auto it = m_words.find(word);
+        return it != m_words.end() ? it->value.count : 0;
+    }
+
+    template<typename Func>
+    void for_each_word(Func func) const
+    {
+        for (auto& item : m_words)
+        {
+            if (item.value.count != 0)
+                func(item.value);
+        }
+    }
+
+    // Call func(word, match) for each word matching query
+    template<typename Func>
+    void for_each_match(StringView query, Func func) const
+    {
+        const UsedLetters letters = used_letters(query);
+
+        const WordIndices* candidates = nullptr;
+        for_each_letter(to_lower(letters), [&](int bit) {
+            if (not candidates or m_letter_words[bit].size() < candidates->size())
+                candidates = &m_letter_words[bit];
+        });
+
+        auto match_word = [&](const Word& word) {
+            if (word.count == 0)
+                return;
+            if (RankedMatch match{word.word->strview(), word.letters, query, letters})
+                func(word, match);
+        };
+
+        if (candidates)
+        {
+            for (auto index : *candidates)
+                match_word((m_words.begin() + index)->value);
+        }
+        else
+        {
+            for (auto& item : m_words)
+                match_word(item.value);
+        }
+    }
+
+    // Returns the words matching query, if max_count is given only the
+    // max_count best ones are returned, sorted.
+    RankedMatchList find_matching(StringView query, size_t max_count = -1) const
+    {
+        // When limited, res is a heap with the worst kept match on top
+        RankedMatchList res;
+        for_each_match(query, [&](const Word&, const RankedMatch& match) {
+            if (res.size() < max_count)
+            {
+                res.push_back(match);
+                if (max_count != (size_t)-1)
+                    std::push_heap(res.begin(), res.end());
+            }
+            else if (match < res.front())
+            {
+                std::pop_heap(res.begin(), res.end());
+                res.back() = match;
+                std::push_heap(res.begin(), res.end());
+            }
+        });
+
+        if (max_count != (size_t)-1)
+            std::sort_heap(res.begin(), res.end());
+        return res;
+    }
+
+    // Words stay with a zero count when removed so that their index in
+    // m_words remains valid, drop them once they outnumber the others.
+    void compact_ifn()
+    {
+        if (m_removed_words == (int)m_words.size())
+            return clear();
+        if (m_removed_words <= 1024 or m_removed_words <= (int)m_words.size() / 2)
+            return;
+
+        Words words;
+        words.reserve(m_words.size() - m_removed_words);
+        for (auto& letter_words : m_letter_words)
+            letter_words.clear();
+
+        for (auto& item : m_words)
+        {
+            if (item.value.count == 0)
+                continue;
+            const int index = (int)words.size();
+            for_each_letter(to_lower(item.value.letters), [&](int bit) {
+                m_letter_words[bit].push_back(index);
+            });
+            words.insert({item.key, std::move(item.value)});
+        }
+        m_words = std::move(words);
+        m_removed_words = 0;
+    }
+
+    void clear()
+    {
+        m_words.clear();
+        m_removed_words = 0;
+        for (auto& letter_words : m_letter_words)
+            letter_words.clear();
+    }
+
+private:
+    template<typename Func>
+    static void for_each_letter(UsedLetters letters, Func func)
+    {
+        for (int bit = 0; letters != 0; ++bit, letters >>= 1)
+        {
+            if (letters & 1)
+                func(bit);
+        }
+    }
+
+    using Words = HashMap<StringView, Word, MemoryDomain::WordDB>;
+    using WordIndices = Vector<int, MemoryDomain::WordDB>;
+    static constexpr int letter_count = 64;
+
+    Words m_words;
+    int m_removed_words = 0;
+    // For each bit of the lower cased used letters, indices in m_words of
+    // the words containing it.
+    WordIndices m_letter_words[letter_count];
+};
+
+struct BufferWordCount
+{
+    const Buffer* buffer;
+    int count;
+};
+using BufferWordCounts = Vector<BufferWordCount, MemoryDomain::WordDB>;
+using SharedWordIndex = WordIndex<BufferWordCounts>;
+
+// Words of all the shared word databases, with their occurrence count in
+// each buffer, so that all buffers can be queried at once.
+SharedWordIndex& shared_word_index();
+
 // maintain a database of words available in a buffer
 class WordDB : public OptionManagerWatcher
 {
 public:
-    WordDB(const Buffer& buffer);
+    // if shared, the buffer words are also maintained in shared_word_index()
+    WordDB(const Buffer& buffer, bool shared = false);
     ~WordDB();
     WordDB(const WordDB&) = delete;
     WordDB(WordDB&&) noexcept;
 
-    RankedMatchList find_matching(StringView str);
+    // Returns the words matching str, if max_count is given only the
+    // max_count best ones are returned, sorted.
+    RankedMatchList find_matching(StringView str, size_t max_count = -1);
 
     int get_word_occurences(StringView word) const;
-private:
+
+    // take buffer modifications since last update into account
     void update_db();
+private:
     void add_words(StringView line);
     void remove_words(StringView line);
 
     void rebuild_db();
+    void unshare_words();
 
     void on_option_changed(const Option& option) override;
 
-    struct WordInfo
-    {
-        StringDataPtr word;
-        UsedLetters letters;
-        int refcount;
-    };
-    using WordToInfo = HashMap<StringView, WordInfo, MemoryDomain::WordDB>;
+    struct NoInfo {};
     using Lines = Vector<StringDataPtr, MemoryDomain::WordDB>;
 
     SafePtr<const Buffer> m_buffer;
+    bool m_shared;
     size_t m_timestamp;
-    WordToInfo m_words;
+    WordIndex<NoInfo> m_words;
     Lines m_lines;
 };
 